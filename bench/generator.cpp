@@ -0,0 +1,99 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/label.hpp"
+#include "../src/uuid_generator.hpp"
+
+using namespace std;
+
+namespace {
+
+const double SPACING_X = 250;
+const double SPACING_Y = 150;
+
+// how far down the model the connections of a node go
+const size_t CONNECTION_WINDOW = 16;
+
+// 'remaining' nodes are left to distribute across 'levels' levels,
+// including this one
+void populate(Architecture &architecture, size_t remaining, size_t levels,
+              const SyntheticModel &model, const string &prefix,
+              mt19937 &rng) {
+  auto count = levels > 1 ? max<size_t>(1, remaining / levels) : remaining;
+  if (count == 0) {
+    return;
+  }
+
+  auto inputs = max<size_t>(1, model.ports / 2);
+  auto outputs = max<size_t>(1, model.ports - inputs);
+  auto columns = max<size_t>(1, sqrt(count));
+
+  vector<NodePtr> nodes;
+  for (size_t idx = 0; idx < count; idx++) {
+    auto id = prefix + to_string(idx + 1);
+
+    auto node = architecture.createNode(true);
+    node->name("Node " + id);
+    node->label(next(LABEL_NAMES.begin(), rng() % LABEL_NAMES.size())->first);
+    node->x(SPACING_X * (idx % columns));
+    node->y(SPACING_Y * (idx / columns));
+
+    auto topic = "/node_" + id;
+    replace(topic.begin(), topic.end(), '.', '_');
+    for (size_t port = 0; port < inputs; port++) {
+      node->createPort({topic + "/input_" + to_string(port + 1) +
+                            " [std_msgs/String]",
+                        Port::Direction::IN, Port::Type::OTHER});
+    }
+    for (size_t port = 0; port < outputs; port++) {
+      node->createPort({topic + "/output_" + to_string(port + 1) +
+                            " [std_msgs/String]",
+                        Port::Direction::OUT, Port::Type::OTHER});
+    }
+    nodes.push_back(node);
+  }
+
+  // ports(): the inputs first, then the outputs
+  for (size_t idx = 0; idx + 1 < count; idx++) {
+    auto window = min(CONNECTION_WINDOW, count - idx - 1);
+    for (size_t link = 0; link < model.fanout; link++) {
+      const auto &from = nodes[idx];
+      const auto &to = nodes[idx + 1 + rng() % window];
+      auto connection = architecture.createConnection(
+          {from, from->ports()[inputs + rng() % outputs]},
+          {to, to->ports()[rng() % inputs]});
+      connection->name = "data";
+    }
+  }
+
+  if (levels > 1) {
+    auto owner = nodes.front();
+    owner->sub_architecture = make_shared<Architecture>();
+    owner->sub_architecture->name = owner->name() + " (sub-architecture)";
+    populate(*owner->sub_architecture, remaining - count, levels - 1, model,
+             prefix + "1.", rng);
+  }
+}
+
+} // namespace
+
+void generate(Architecture &architecture, const SyntheticModel &model) {
+  seed_uuids(model.seed);
+  mt19937 rng(model.seed);
+
+  architecture.uuid = make_uuid();
+  architecture.name = "Synthetic architecture";
+  architecture.description = "Synthetic model: " + to_string(model.nodes) +
+                             " nodes, fan-out " + to_string(model.fanout) +
+                             ", " + to_string(model.ports) +
+                             " ports per node, depth " +
+                             to_string(model.depth);
+
+  populate(architecture, model.nodes, max<size_t>(1, model.depth), model, "",
+           rng);
+}
@@ -0,0 +1,39 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstddef>
+
+#include "../src/architecture.hpp"
+
+/**
+ * Shape of a synthetic model.
+ */
+struct SyntheticModel {
+  // total number of nodes, across the whole hierarchy
+  size_t nodes = 1000;
+  // connections from each node's outputs to nodes further down the model
+  size_t fanout = 2;
+  // ports of each node, half of them inputs (at least one input and one
+  // output)
+  size_t ports = 4;
+  // levels of the hierarchy (1: no sub-architecture)
+  size_t depth = 1;
+
+  unsigned int seed = 0;
+};
+
+/**
+ * Fills 'architecture' (expected empty) with a synthetic model, modelled on
+ * doc/sample_architecture.json: labelled nodes laid out on a grid, with ROS
+ * topic-like ports ('/node_12/output_1 [std_msgs/String]'), connected
+ * forward (the model is acyclic).
+ *
+ * The nodes are evenly split between the levels of the hierarchy: the first
+ * node of each level owns the sub-architecture holding the next level.
+ *
+ * The same options (including the seed) always produce the same model, with
+ * the same UUIDs: UUIDs are made deterministic (see seed_uuids).
+ */
+void generate(Architecture &architecture, const SyntheticModel &model);
+
+#endif // GENERATOR_HPP
@@ -0,0 +1,244 @@
+/* See LICENSE file for copyright and license details. */
+
+#define STR_EXPAND(tok) #tok
+#define STR(tok) STR_EXPAND(tok)
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+#include "../src/architecture.hpp"
+#include "../src/inja_visitor.hpp"
+#include "../src/json/json.h"
+#include "../src/json_visitor.hpp"
+#include "../src/ros_visitor.hpp"
+#include "../src/tikz_visitor.hpp"
+#include "generator.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// the shipped templates meant for --tpl
+const vector<string> INJA_TEMPLATES{"tikz_dvisvgm_tpl.tex"};
+
+/**
+ * Silences std::cout and std::cerr while alive: the loader and the
+ * exporters are verbose, and the results are written on std::cout.
+ */
+class Silence {
+public:
+  Silence() : _cout(cout.rdbuf(&_null)), _cerr(cerr.rdbuf(&_null)) {}
+  ~Silence() {
+    cout.rdbuf(_cout);
+    cerr.rdbuf(_cerr);
+  }
+
+private:
+  struct NullBuffer : public streambuf {
+    int overflow(int c) override { return c; }
+  };
+
+  NullBuffer _null;
+  streambuf *_cout;
+  streambuf *_cerr;
+};
+
+/**
+ * Runs 'operation' 'repeat' times, and returns its timings (in seconds).
+ */
+Json::Value measure(const string &name, size_t repeat,
+                    const function<void()> &operation) {
+  vector<double> durations;
+
+  for (size_t run = 0; run < repeat; run++) {
+    Silence silence;
+    auto start = chrono::steady_clock::now();
+    operation();
+    durations.push_back(
+        chrono::duration<double>(chrono::steady_clock::now() - start)
+            .count());
+  }
+
+  Json::Value result;
+  result["name"] = name;
+  for (auto duration : durations) {
+    result["seconds"].append(duration);
+  }
+
+  sort(durations.begin(), durations.end());
+  result["min"] = durations.front();
+  result["median"] = durations[durations.size() / 2];
+  result["mean"] = accumulate(durations.begin(), durations.end(), 0.) /
+                   durations.size();
+  return result;
+}
+
+void count(const Architecture &architecture, Json::Value &model) {
+  model["architectures"] = model["architectures"].asUInt64() + 1;
+  model["nodes"] =
+      Json::UInt64(model["nodes"].asUInt64() + architecture.nodes().size());
+  model["connections"] = Json::UInt64(model["connections"].asUInt64() +
+                                      architecture.connections().size());
+
+  for (const auto &node : architecture.nodes()) {
+    if (node->sub_architecture) {
+      count(*node->sub_architecture, model);
+    }
+  }
+}
+
+Json::Value benchmark(const string &path, const fs::path &tmp,
+                      size_t repeat) {
+  Json::Value report;
+  report["model"]["path"] = path;
+
+  Architecture architecture;
+  {
+    Silence silence;
+    architecture.load(path);
+  }
+  count(architecture, report["model"]);
+
+  auto &results = report["results"];
+
+  results.append(measure("load", repeat, [&]() {
+    Architecture loaded;
+    loaded.load(path);
+  }));
+
+  results.append(measure("save", repeat, [&]() {
+    JsonVisitor json(architecture);
+    ofstream(tmp / "save.json") << json.visit();
+  }));
+
+  results.append(measure("json", repeat, [&]() {
+    JsonVisitor json(architecture);
+    json.visit();
+  }));
+
+  results.append(measure("tikz", repeat, [&]() {
+    TikzVisitor tikz(architecture);
+    tikz.visit();
+  }));
+
+  for (const auto &tpl : INJA_TEMPLATES) {
+    results.append(measure("inja " + tpl, repeat, [&]() {
+      InjaVisitor visitor(architecture, tpl,
+                          (tmp / fs::path(tpl).filename()).string());
+      visitor.visit();
+    }));
+  }
+
+  results.append(measure("ros", repeat, [&]() {
+    auto ws = tmp / "ros";
+    fs::remove_all(ws);
+    fs::create_directories(ws);
+    RosVisitor visitor(architecture, ws.string());
+    visitor.visit();
+  }));
+
+  return report;
+}
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+
+  QCoreApplication::setApplicationName("boxology");
+  QCoreApplication::setApplicationVersion(STR(BOXOLOGY_VERSION));
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Benchmarks the loading, saving and exports of Boxology models. The "
+      "results are written on stdout, in JSON.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument(
+      "models",
+      "The models to benchmark (default: a synthetic model, see the options "
+      "below)",
+      "[models...]");
+
+  parser.addOptions(
+      {{"generate",
+        "Only write a synthetic model to a file, without running the "
+        "benchmarks",
+        "file"},
+       {"nodes", "Synthetic model: total number of nodes", "count", "1000"},
+       {"fanout", "Synthetic model: connections from each node", "count",
+        "2"},
+       {"ports", "Synthetic model: ports of each node", "count", "4"},
+       {"depth", "Synthetic model: levels of the hierarchy", "count", "1"},
+       {"seed", "Synthetic model: random seed", "seed", "0"},
+       {"repeat", "Number of runs of each benchmark", "count", "3"}});
+
+  parser.process(app);
+
+  SyntheticModel synthetic;
+  synthetic.nodes = parser.value("nodes").toULong();
+  synthetic.fanout = parser.value("fanout").toULong();
+  synthetic.ports = parser.value("ports").toULong();
+  synthetic.depth = parser.value("depth").toULong();
+  synthetic.seed = parser.value("seed").toUInt();
+
+  if (parser.isSet("generate")) {
+    Architecture architecture;
+    generate(architecture, synthetic);
+    JsonVisitor json(architecture);
+    ofstream(parser.value("generate").toStdString()) << json.visit();
+    return 0;
+  }
+
+  auto tmp = fs::temp_directory_path() /
+             ("boxology-bench-" + to_string(random_device()()));
+  fs::create_directories(tmp);
+
+  // times the shipped templates (no overrides), unless $BOXOLOGY_TEMPLATES
+  // is set
+  if (qgetenv("BOXOLOGY_TEMPLATES").isEmpty()) {
+    qputenv("BOXOLOGY_TEMPLATES",
+            QByteArray::fromStdString((tmp / "templates").string()));
+  }
+
+  vector<string> models;
+  for (const auto &model : parser.positionalArguments()) {
+    models.push_back(model.toStdString());
+  }
+
+  Json::Value report;
+  report["boxology_version"] = STR(BOXOLOGY_VERSION);
+  report["repeat"] = parser.value("repeat").toUInt();
+
+  if (models.empty()) {
+    Architecture architecture;
+    generate(architecture, synthetic);
+    JsonVisitor json(architecture);
+    ofstream(tmp / "synthetic.json") << json.visit();
+    models.push_back((tmp / "synthetic.json").string());
+
+    auto &options = report["synthetic"];
+    options["nodes"] = Json::UInt64(synthetic.nodes);
+    options["fanout"] = Json::UInt64(synthetic.fanout);
+    options["ports"] = Json::UInt64(synthetic.ports);
+    options["depth"] = Json::UInt64(synthetic.depth);
+    options["seed"] = synthetic.seed;
+  }
+
+  for (const auto &model : models) {
+    report["benchmarks"].append(
+        benchmark(model, tmp, max(1u, parser.value("repeat").toUInt())));
+  }
+
+  fs::remove_all(tmp);
+
+  Json::StyledWriter writer;
+  cout << writer.write(report);
+
+  return 0;
+}
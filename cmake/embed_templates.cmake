@@ -0,0 +1,59 @@
+# Generates a C++ source embedding all the files of a templates directory
+# (see src/templates.hpp).
+#
+#   cmake -DTEMPLATES_DIR=<templates dir> -DOUTPUT=<file.cpp>
+#         -P embed_templates.cmake
+
+file(GLOB_RECURSE TEMPLATES RELATIVE ${TEMPLATES_DIR} ${TEMPLATES_DIR}/*)
+list(SORT TEMPLATES)
+
+# CMake regexes have no repetition count: 16 bytes per line
+set(LINE "")
+foreach(BYTE RANGE 15)
+    set(LINE "${LINE}0x..,")
+endforeach()
+
+set(DATA "")
+set(ENTRIES "")
+set(INDEX 0)
+
+foreach(TEMPLATE ${TEMPLATES})
+    file(READ ${TEMPLATES_DIR}/${TEMPLATE} CONTENT HEX)
+    string(LENGTH "${CONTENT}" SIZE)
+    math(EXPR SIZE "${SIZE} / 2")
+
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," CONTENT "${CONTENT}")
+    string(REGEX REPLACE "(${LINE})" "\\1\n    " CONTENT "${CONTENT}")
+
+    # null-terminated, for convenience
+    set(DATA "${DATA}// ${TEMPLATE}
+const unsigned char TEMPLATE_${INDEX}[] = {
+    ${CONTENT}0x00};
+
+")
+    set(ENTRIES "${ENTRIES}      {\"${TEMPLATE}\",
+       {reinterpret_cast<const char *>(TEMPLATE_${INDEX}), ${SIZE}}},
+")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(SOURCE "// Generated by cmake/embed_templates.cmake: do not edit.
+
+#include \"templates.hpp\"
+
+namespace {
+
+${DATA}} // namespace
+
+const std::map<std::string, std::string_view> &embedded_templates() {
+  static const std::map<std::string, std::string_view> templates{
+${ENTRIES}  };
+  return templates;
+}
+")
+
+# only touch the output if it changed, to avoid needless rebuilds
+file(WRITE ${OUTPUT}.tmp "${SOURCE}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different
+                ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,219 @@
+/* See LICENSE file for copyright and license details. */
+
+#include "commands.hpp"
+
+#include "../layout.hpp"
+#include "../view/scene.hpp"
+#include "mainwindow.hpp"
+
+using namespace std;
+
+namespace {
+
+// the changes of a node with a graphics item are reported by the scene
+// (Node::dirty, see GraphicsNodeScene::add and MainWindow::track_scene): the
+// commands only report the changes of the other nodes
+bool displayed(GraphicsNodeScene* scene, const NodePtr& node) {
+    return scene && scene->item(node.get());
+}
+
+}  // namespace
+
+RemoveCommand::RemoveCommand(MainWindow* window, Architecture* architecture,
+                             const Architecture::Nodes& nodes,
+                             const Architecture::Connections& connections)
+    : _window(window),
+      _architecture(architecture),
+      _nodes(nodes),
+      _connections(connections) {
+    // the connections involving the removed nodes are removed as well, and
+    // have to be restored with them
+    if (!_nodes.empty()) {
+        for (const auto& c : _architecture->connections()) {
+            if (_nodes.count(c->from.node.lock()) ||
+                _nodes.count(c->to.node.lock())) {
+                _connections.insert(c);
+            }
+        }
+    }
+
+    if (_nodes.empty()) {
+        setText(QString("Remove %1 connection(s)").arg(_connections.size()));
+    } else {
+        setText(QString("Remove %1 node(s)").arg(_nodes.size()));
+    }
+}
+
+void RemoveCommand::redo() {
+    auto scene = _window->scene(_architecture);
+
+    // the scene reports the removals itself (connectionRemoved,
+    // nodeRemoved)
+    for (auto c : _connections) {
+        if (scene) {
+            scene->remove(c);
+        } else {
+            _architecture->removeConnection(c->from, c->to);
+            _window->journal().connectionRemoved(*_architecture, c);
+            _window->search_index().remove(c);
+        }
+    }
+
+    for (auto n : _nodes) {
+        if (scene) {
+            scene->remove(n);
+        } else {
+            _architecture->removeNode(n);
+            _window->journal().nodeRemoved(*_architecture, n);
+            _window->search_index().remove(n);
+        }
+    }
+}
+
+void RemoveCommand::undo() {
+    for (auto n : _nodes) {
+        _architecture->addNode(n, true);
+        _window->journal().nodeChanged(*_architecture, n);
+        _window->search_index().add(*_architecture, n);
+    }
+    for (auto c : _connections) {
+        _architecture->addConnection(c);
+        _window->journal().connectionChanged(*_architecture, c);
+        _window->search_index().add(*_architecture, c);
+    }
+
+    auto scene = _window->scene(_architecture);
+    if (scene) {
+        scene->populate(_nodes, _connections);
+    }
+}
+
+AddNodesCommand::AddNodesCommand(MainWindow* window,
+                                 Architecture* architecture,
+                                 const Architecture::Nodes& nodes,
+                                 const QString& text)
+    : QUndoCommand(text),
+      _window(window),
+      _architecture(architecture),
+      _nodes(nodes) {}
+
+void AddNodesCommand::redo() {
+    for (auto n : _nodes) {
+        _architecture->addNode(n, true);
+        _window->journal().nodeChanged(*_architecture, n);
+        _window->search_index().add(*_architecture, n);
+    }
+
+    auto scene = _window->scene(_architecture);
+    if (scene) {
+        scene->populate(_nodes, {});
+    }
+}
+
+void AddNodesCommand::undo() {
+    auto scene = _window->scene(_architecture);
+
+    for (auto n : _nodes) {
+        if (scene) {
+            scene->remove(n);
+        } else {
+            _architecture->removeNode(n);
+            _window->journal().nodeRemoved(*_architecture, n);
+            _window->search_index().remove(n);
+        }
+    }
+}
+
+RelabelCommand::RelabelCommand(MainWindow* window, Architecture* architecture,
+                               const Architecture::Nodes& nodes, Label label)
+    : QUndoCommand(QString("Relabel %1 node(s)").arg(nodes.size())),
+      _window(window),
+      _architecture(architecture),
+      _label(label) {
+    for (auto n : nodes) {
+        _previous_labels[n] = n->label();
+    }
+}
+
+void RelabelCommand::redo() {
+    auto scene = _window->scene(_architecture);
+    for (const auto& kv : _previous_labels) {
+        kv.first->label(_label);
+        if (!displayed(scene, kv.first)) {
+            _window->journal().nodeChanged(*_architecture, kv.first);
+        }
+    }
+}
+
+void RelabelCommand::undo() {
+    auto scene = _window->scene(_architecture);
+    for (const auto& kv : _previous_labels) {
+        kv.first->label(kv.second);
+        if (!displayed(scene, kv.first)) {
+            _window->journal().nodeChanged(*_architecture, kv.first);
+        }
+    }
+}
+
+RenameNodeCommand::RenameNodeCommand(MainWindow* window,
+                                     Architecture* architecture, NodePtr node,
+                                     const string& name)
+    : QUndoCommand(QString("Rename %1").arg(QString::fromStdString(name))),
+      _window(window),
+      _architecture(architecture),
+      _node(node),
+      _previous_name(node->name()),
+      _name(name) {}
+
+void RenameNodeCommand::redo() { rename(_name); }
+
+void RenameNodeCommand::undo() { rename(_previous_name); }
+
+void RenameNodeCommand::rename(const string& name) {
+    _node->name(name);
+    if (!displayed(_window->scene(_architecture), _node)) {
+        _window->journal().nodeChanged(*_architecture, _node);
+    }
+}
+
+LayoutCommand::LayoutCommand(MainWindow* window, Architecture* architecture)
+    : QUndoCommand("Auto layout"),
+      _window(window),
+      _architecture(architecture) {
+    for (auto n : _architecture->nodes()) {
+        _previous_geometries[n] =
+            Geometry(n->x(), n->y(), n->width(), n->height());
+    }
+}
+
+void LayoutCommand::redo() {
+    if (_geometries.empty()) {
+        auto_layout(*_architecture, false);
+        for (auto n : _architecture->nodes()) {
+            _geometries[n] = Geometry(n->x(), n->y(), n->width(), n->height());
+        }
+    }
+    apply(_geometries);
+}
+
+void LayoutCommand::undo() { apply(_previous_geometries); }
+
+void LayoutCommand::apply(const map<NodePtr, Geometry>& geometries) {
+    // the displayed nodes are reported by the scene, as their items move
+    auto scene = _window->scene(_architecture);
+    for (const auto& kv : geometries) {
+        double x, y, width, height;
+        tie(x, y, width, height) = kv.second;
+        kv.first->x(x);
+        kv.first->y(y);
+        kv.first->width(width);
+        kv.first->height(height);
+        if (!displayed(scene, kv.first)) {
+            _window->journal().nodeChanged(*_architecture, kv.first);
+        }
+    }
+
+    if (scene) {
+        scene->refreshGeometry();
+    }
+}
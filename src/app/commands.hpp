@@ -0,0 +1,128 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef __COMMANDS_HPP
+#define __COMMANDS_HPP
+
+#include <QUndoCommand>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include "../architecture.hpp"
+#include "../connection.hpp"
+#include "../label.hpp"
+#include "../node.hpp"
+
+class MainWindow;
+
+/**
+ * Undoable changes to an architecture.
+ *
+ * The commands only record what the change affects (the removed nodes and
+ * connections themselves, the previous labels,...), not snapshots of the
+ * architecture. Removed nodes and connections are kept alive by the command,
+ * so that undoing restores the very same objects, with their ports and
+ * UUIDs.
+ *
+ * The commands operate on the model, and update the scene displaying the
+ * architecture if there is one (sub-architecture scenes might have been
+ * released in the meantime). The changes are recorded in the journal and
+ * the search index once: by the scene for the removals and the changes of
+ * the displayed nodes (see MainWindow::track_scene), by the commands
+ * otherwise.
+ */
+
+class RemoveCommand : public QUndoCommand {
+   public:
+    /**
+     * Removes the nodes, the connections, and all the connections involving
+     * the nodes.
+     */
+    RemoveCommand(MainWindow* window, Architecture* architecture,
+                  const Architecture::Nodes& nodes,
+                  const Architecture::Connections& connections);
+
+    void redo() override;
+    void undo() override;
+
+   private:
+    MainWindow* _window;
+    Architecture* _architecture;
+    Architecture::Nodes _nodes;
+    Architecture::Connections _connections;
+};
+
+class AddNodesCommand : public QUndoCommand {
+   public:
+    AddNodesCommand(MainWindow* window, Architecture* architecture,
+                    const Architecture::Nodes& nodes, const QString& text);
+
+    void redo() override;
+    void undo() override;
+
+   private:
+    MainWindow* _window;
+    Architecture* _architecture;
+    Architecture::Nodes _nodes;
+};
+
+class RelabelCommand : public QUndoCommand {
+   public:
+    RelabelCommand(MainWindow* window, Architecture* architecture,
+                   const Architecture::Nodes& nodes, Label label);
+
+    void redo() override;
+    void undo() override;
+
+   private:
+    MainWindow* _window;
+    Architecture* _architecture;
+    std::map<NodePtr, Label> _previous_labels;
+    Label _label;
+};
+
+class RenameNodeCommand : public QUndoCommand {
+   public:
+    RenameNodeCommand(MainWindow* window, Architecture* architecture,
+                      NodePtr node, const std::string& name);
+
+    void redo() override;
+    void undo() override;
+
+   private:
+    void rename(const std::string& name);
+
+    MainWindow* _window;
+    Architecture* _architecture;
+    NodePtr _node;
+    std::string _previous_name;
+    std::string _name;
+};
+
+/**
+ * Lays out the nodes of an architecture (not the ones of its
+ * sub-architectures, see auto_layout). Undoing restores the previous
+ * positions and sizes of the nodes.
+ */
+class LayoutCommand : public QUndoCommand {
+   public:
+    LayoutCommand(MainWindow* window, Architecture* architecture);
+
+    void redo() override;
+    void undo() override;
+
+   private:
+    // x, y, width, height
+    typedef std::tuple<double, double, double, double> Geometry;
+
+    void apply(const std::map<NodePtr, Geometry>& geometries);
+
+    MainWindow* _window;
+    Architecture* _architecture;
+    std::map<NodePtr, Geometry> _previous_geometries;
+    // empty until the layout is first computed
+    std::map<NodePtr, Geometry> _geometries;
+};
+
+#endif  // __COMMANDS_HPP
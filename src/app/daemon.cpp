@@ -0,0 +1,273 @@
+/* See LICENSE file for copyright and license details. */
+
+#include "daemon.hpp"
+
+#include <QLocalSocket>
+#include <QPointer>
+#include <QRunnable>
+#include <curl/curl.h>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+#include "../diff.hpp"
+#include "../flatten.hpp"
+#include "../graph.hpp"
+#include "../inja_visitor.hpp"
+#include "../json_visitor.hpp"
+#include "../md_visitor.hpp"
+#include "../memory_stats.hpp"
+#include "../ros_visitor.hpp"
+#include "../rst_visitor.hpp"
+#include "../tikz_visitor.hpp"
+#include "../trace.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// a function run by the worker pool
+class Job : public QRunnable {
+   public:
+    explicit Job(function<void()> f) : _f(std::move(f)) {}
+
+    void run() override { _f(); }
+
+   private:
+    function<void()> _f;
+};
+
+string field(const Json::Value& request, const char* name) {
+    if (!request[name].isString()) {
+        throw runtime_error(string("Missing \"") + name + "\" (string)");
+    }
+    return request[name].asString();
+}
+
+Json::Value names(const Graph::NodeList& nodes) {
+    Json::Value result = Json::arrayValue;
+    for (const auto& node : nodes) {
+        result.append(node->name());
+    }
+    return result;
+}
+
+// one reply per line
+string toLine(const Json::Value& reply) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, reply) + "\n";
+}
+
+}  // namespace
+
+shared_ptr<const Architecture> ModelCache::get(const string& path) {
+    error_code error;
+    auto mtime = fs::last_write_time(path, error);
+    if (error) {
+        throw runtime_error("Unable to open " + path + ": " +
+                            error.message());
+    }
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->path == path && it->mtime == mtime) {
+                _entries.splice(_entries.begin(), _entries, it);
+                return it->architecture;
+            }
+        }
+    }
+
+    // loaded without holding the lock, not to hold up the requests on other
+    // models (concurrent requests on the same new model both load it)
+    auto architecture = make_shared<Architecture>();
+    try {
+        architecture->load(path);
+    } catch (const Json::RuntimeError&) {
+        throw runtime_error("Invalid JSON in " + path);
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    _entries.remove_if([&](const Entry& entry) { return entry.path == path; });
+    _entries.push_front({path, mtime, architecture});
+    if (_entries.size() > _capacity) {
+        _entries.pop_back();
+    }
+    return architecture;
+}
+
+Daemon::Daemon(QObject* parent)
+    : QObject(parent),
+      _server(new QLocalServer(this)),
+      _models(MODEL_CACHE_SIZE) {
+    // the exporters fetch remote content with libcurl: initialize it now,
+    // since its implicit initialization is not thread-safe
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // the models and their exports are only for the user running the daemon
+    _server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(_server, &QLocalServer::newConnection, this,
+            &Daemon::onNewConnection);
+}
+
+bool Daemon::listen(const QString& name) {
+    if (_server->listen(name)) return true;
+    if (_server->serverError() != QAbstractSocket::AddressInUseError) {
+        return false;
+    }
+
+    // nobody answering: the socket was left by a daemon that crashed
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(STALE_SOCKET_TIMEOUT)) return false;
+
+    QLocalServer::removeServer(name);
+    return _server->listen(name);
+}
+
+void Daemon::onNewConnection() {
+    while (auto socket = _server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket,
+                &QObject::deleteLater);
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            while (socket->canReadLine()) {
+                auto request = socket->readLine().trimmed().toStdString();
+                if (request.empty()) continue;
+
+                // the client may be gone by the time the reply is ready
+                QPointer<QLocalSocket> client(socket);
+                _workers.start(new Job([this, request, client]() {
+                    auto reply = toLine(process(request));
+                    QMetaObject::invokeMethod(
+                        this,
+                        [client, reply]() {
+                            if (client) client->write(reply.c_str());
+                        },
+                        Qt::QueuedConnection);
+                }));
+            }
+        });
+    }
+}
+
+Json::Value Daemon::process(const string& line) {
+    Json::Value request, reply;
+
+    Json::CharReaderBuilder builder;
+    string errors;
+    istringstream input(line);
+    if (!Json::parseFromStream(builder, input, &request, &errors) ||
+        !request.isObject()) {
+        reply["ok"] = false;
+        reply["error"] = "Invalid request (expected a JSON object): " + errors;
+        return reply;
+    }
+
+    reply["id"] = request["id"];
+
+    TraceScope trace("request", "daemon");
+    auto command = request["command"].asString();
+    trace.arg("command", command);
+
+    try {
+        Json::Value result;
+        if (command == "export") {
+            result = exportModel(request);
+        } else if (command == "diff") {
+            result = toJson(diff(*_models.get(field(request, "from")),
+                                 *_models.get(field(request, "to"))));
+        } else if (command == "query") {
+            result = query(request);
+        } else {
+            throw runtime_error("Unknown command <" + command + ">");
+        }
+        reply["ok"] = true;
+        reply["result"] = result;
+    } catch (const exception& e) {
+        reply["ok"] = false;
+        reply["error"] = e.what();
+    }
+    return reply;
+}
+
+Json::Value Daemon::exportModel(const Json::Value& request) {
+    shared_ptr<const Architecture> architecture =
+        _models.get(field(request, "model"));
+    if (request["flatten"].asBool()) {
+        architecture = flatten(*architecture);
+    }
+
+    auto format = field(request, "format");
+
+    if (format == "json") {
+        return JsonVisitor(*architecture).visit();
+    } else if (format == "latex") {
+        return TikzVisitor(*architecture).visit();
+    }
+
+    auto output = field(request, "output");
+
+    if (format == "tpl") {
+        InjaVisitor visitor(*architecture, field(request, "template"), output);
+        if (!visitor.ready()) {
+            throw runtime_error("No template named " +
+                                request["template"].asString());
+        }
+        auto content = visitor.visit();
+
+        auto directory = fs::path(output).parent_path();
+        if (!directory.empty()) fs::create_directories(directory);
+        ofstream file(output);
+        file << content;
+        if (!file) throw runtime_error("Unable to write " + output);
+        return content;
+    }
+
+    fs::create_directories(output);
+
+    if (format == "markdown") {
+        return MdVisitor(*architecture, output).visit();
+    } else if (format == "rst") {
+        return RstVisitor(*architecture, output).visit();
+    } else if (format == "ros") {
+        return RosVisitor(*architecture, output).visit();
+    }
+    throw runtime_error("Unknown format <" + format + ">");
+}
+
+Json::Value Daemon::query(const Json::Value& request) {
+    auto architecture = _models.get(field(request, "model"));
+    auto query = field(request, "query");
+
+    if (query == "stats") {
+        return statistics(*architecture);
+    }
+
+    Graph graph(*architecture);
+
+    if (query == "order") {
+        return names(graph.topologicalOrder());
+    } else if (query == "cycles") {
+        Json::Value cycles = Json::arrayValue;
+        for (const auto& cycle : graph.cycles()) {
+            cycles.append(names(cycle));
+        }
+        return cycles;
+    } else if (query == "fan-in") {
+        return names(
+            graph.fanIn(find_node(*architecture, field(request, "node"))));
+    } else if (query == "fan-out") {
+        return names(
+            graph.fanOut(find_node(*architecture, field(request, "node"))));
+    } else if (query == "path") {
+        return names(graph.shortestPath(
+            find_node(*architecture, field(request, "node")),
+            find_node(*architecture, field(request, "to"))));
+    }
+    throw runtime_error("Unknown query <" + query + ">");
+}
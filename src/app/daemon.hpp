@@ -0,0 +1,113 @@
+/* See LICENSE file for copyright and license details. */
+
+#ifndef __DAEMON_HPP
+#define __DAEMON_HPP
+
+#include <QLocalServer>
+#include <QObject>
+#include <QThreadPool>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../architecture.hpp"
+#include "../json/json.h"
+
+// the number of models kept loaded by the daemon
+const size_t MODEL_CACHE_SIZE = 16;
+
+// how long to wait for a daemon on an existing socket before replacing it (ms)
+const int STALE_SOCKET_TIMEOUT = 500;
+
+/**
+ * The models recently used by the daemon, most recently used first.
+ *
+ * A model is identified by its path and the modification time of its file:
+ * a model saved since it was loaded is loaded again. The cached models are
+ * shared by the requests, and must not be modified.
+ */
+class ModelCache {
+   public:
+    explicit ModelCache(size_t capacity) : _capacity(capacity) {}
+
+    /**
+     * Returns the model stored at 'path', loading it if needed (possibly
+     * concurrently with other requests). Throws a runtime_error if the
+     * model can not be loaded.
+     */
+    std::shared_ptr<const Architecture> get(const std::string& path);
+
+   private:
+    struct Entry {
+        std::string path;
+        std::filesystem::file_time_type mtime;
+        std::shared_ptr<const Architecture> architecture;
+    };
+
+    std::mutex _mutex;
+    std::list<Entry> _entries;
+    size_t _capacity;
+};
+
+/**
+ * Resident export server (boxology --daemon <socket>).
+ *
+ * Clients connect to a local socket (a Unix domain socket, or a named pipe
+ * on Windows) and send one JSON request per line:
+ *
+ *   {"id": 1, "command": "export", "model": "a.json", "format": "ros",
+ *    "output": "ws/"}
+ *
+ * Each request gets a one line JSON reply, with the same "id":
+ *
+ *   {"id": 1, "ok": true, "result": ...}
+ *   {"id": 1, "ok": false, "error": "..."}
+ *
+ * The requests are processed concurrently by a pool of workers: the replies
+ * can arrive out of order.
+ *
+ * Commands:
+ * - "export": "model", "format" (json, latex, markdown, rst, ros or tpl),
+ *   "output" (the output directory, or file for tpl), "template" (tpl
+ *   only), "flatten" (optional). The result is the output of the exporter
+ *   (for tpl, the rendered document, also written to "output"). The
+ *   exporters log their progress on stderr.
+ * - "diff": "from" and "to" models. The result is the changes (as
+ *   --diff).
+ * - "query": "model", "query" (order, cycles, fan-in, fan-out, path or
+ *   stats), "node" (fan-in, fan-out and path), "to" (path).
+ */
+class Daemon : public QObject {
+   public:
+    explicit Daemon(QObject* parent = nullptr);
+
+    /**
+     * Starts accepting connections on the local socket 'name' (a path, or
+     * a name in the temporary directory). A stale socket left by a daemon
+     * that did not stop cleanly is replaced.
+     */
+    bool listen(const QString& name);
+
+    QString errorString() const { return _server->errorString(); }
+
+    /**
+     * Processes a request (one line of JSON), and returns its reply.
+     * Thread-safe.
+     */
+    Json::Value process(const std::string& request);
+
+   private:
+    void onNewConnection();
+
+    Json::Value exportModel(const Json::Value& request);
+    Json::Value query(const Json::Value& request);
+
+    QLocalServer* _server;
+    ModelCache _models;
+    // last, to wait for the running requests before destroying the rest
+    QThreadPool _workers;
+};
+
+#endif
@@ -6,22 +6,373 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <cstring>
 #include <iostream>
 
+#include "../diff.hpp"
+#include "../flatten.hpp"
+#include "../graph.hpp"
 #include "../inja_visitor.hpp"
 #include "../json/json.h"
 #include "../json_visitor.hpp"
+#include "../layout.hpp"
 #include "../md_visitor.hpp"
+#include "../memory_stats.hpp"
 #include "../ros_visitor.hpp"
 #include "../rst_visitor.hpp"
+#include "../select.hpp"
+#include "../templates.hpp"
 #include "../tikz_visitor.hpp"
+#include "../trace.hpp"
+#include "daemon.hpp"
 #include "mainwindow.hpp"
 
 using namespace std;
 
+// --watch: how long a file must be left alone before exporting again
+const int WATCH_SETTLE_MS = 50;
+
+bool load(Architecture &architecture, const QString &path) {
+  try {
+    architecture.load(path.toStdString());
+  } catch (Json::RuntimeError jre) {
+    cerr << "Unable to process the architecture: invalid JSON!";
+    return false;
+  } catch (runtime_error e) {
+    cerr << "Unable to process the architecture:" << e.what();
+    return false;
+  }
+  return true;
+}
+
+void print_nodes(const Graph::NodeList &nodes) {
+  for (const auto &node : nodes) {
+    cout << node->name() << endl;
+  }
+}
+
+int analyze(const Architecture &architecture,
+            const QCommandLineParser &parser) {
+  Graph graph(architecture);
+
+  try {
+    if (parser.isSet("order")) {
+      print_nodes(graph.topologicalOrder());
+    } else if (parser.isSet("cycles")) {
+      for (const auto &cycle : graph.cycles()) {
+        string separator;
+        for (const auto &node : cycle) {
+          cout << separator << node->name();
+          separator = ", ";
+        }
+        cout << endl;
+      }
+    } else if (parser.isSet("fan-in")) {
+      print_nodes(graph.fanIn(
+          find_node(architecture, parser.value("fan-in").toStdString())));
+    } else if (parser.isSet("fan-out")) {
+      print_nodes(graph.fanOut(
+          find_node(architecture, parser.value("fan-out").toStdString())));
+    } else if (parser.isSet("path")) {
+      auto ends = parser.values("path");
+      if (ends.size() != 2) {
+        cerr << "--path must be given twice: the origin, then the "
+                "destination"
+             << endl;
+        return 1;
+      }
+      auto path = graph.shortestPath(
+          find_node(architecture, ends[0].toStdString()),
+          find_node(architecture, ends[1].toStdString()));
+      if (path.empty()) {
+        cerr << "No path from <" << ends[0].toStdString() << "> to <"
+             << ends[1].toStdString() << ">" << endl;
+        return 1;
+      }
+      print_nodes(path);
+    }
+  } catch (runtime_error e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// --flatten and --select: reduces the loaded model to the part to export or
+// analyse, then --layout positions its nodes. Returns false if the query is
+// invalid.
+bool prepare(Architecture &architecture, const QCommandLineParser &parser) {
+  if (parser.isSet("flatten")) {
+    architecture.replaceWith(std::move(*flatten(architecture)));
+  }
+
+  if (parser.isSet("select")) {
+    try {
+      auto selection =
+          Selector(architecture).select(parser.value("select").toStdString());
+      architecture.replaceWith(std::move(*extract(architecture, selection)));
+    } catch (const runtime_error &e) {
+      cerr << e.what() << endl;
+      return false;
+    }
+  }
+
+  if (parser.isSet("layout")) {
+    auto_layout(architecture);
+  }
+  return true;
+}
+
+// prints the nodes, then the connections of the model
+void print_subgraph(const Architecture &architecture) {
+  for (const auto &node : architecture.nodes()) {
+    cout << node->name() << endl;
+  }
+  for (const auto &connection : architecture.connections()) {
+    auto from = connection->from.node.lock();
+    auto from_port = connection->from.port.lock();
+    auto to = connection->to.node.lock();
+    auto to_port = connection->to.port.lock();
+    if (!from || !from_port || !to || !to_port) {
+      continue;
+    }
+    cout << from->name() << ":" << from_port->name << " -> " << to->name()
+         << ":" << to_port->name << endl;
+  }
+}
+
+// --diff a b: prints the changes from a to b.
+// --merge base ours theirs: prints the merged model, and the conflicting
+// changes of 'theirs' (not applied) on stderr.
+int compare(const QStringList &paths, bool merging) {
+  if (paths.size() != (merging ? 3 : 2)) {
+    cerr << (merging ? "--merge expects 3 models: base, ours and theirs"
+                     : "--diff expects 2 models")
+         << endl;
+    return 1;
+  }
+
+  vector<Architecture> models(paths.size());
+  for (int idx = 0; idx < paths.size(); idx++) {
+    if (!load(models[idx], paths[idx])) {
+      return 1;
+    }
+  }
+
+  Json::StyledWriter writer;
+
+  if (!merging) {
+    cout << writer.write(toJson(diff(models[0], models[1])));
+    return 0;
+  }
+
+  auto conflicts = merge(models[0], models[1], models[2]);
+
+  JsonVisitor json(models[1]);
+  cout << json.visit();
+
+  if (!conflicts.empty()) {
+    cerr << writer.write(toJson(conflicts));
+    return 1;
+  }
+  return 0;
+}
+
+// exports the model as requested on the command line (--to-json, --tpl...)
+int export_model(const Architecture &architecture,
+                 const QCommandLineParser &parser, const QStringList &args) {
+  if (parser.isSet("to-json")) {
+    JsonVisitor json(architecture);
+    auto output = json.visit();
+
+    cout << output;
+
+    return 0;
+  } else if (parser.isSet("tpl")) {
+    QFileInfo src(args[0]);
+    QFileInfo tpl(parser.values("tpl")[0]);
+
+    auto output_file =
+        src.absolutePath() + "/" + src.baseName() + "." + tpl.suffix();
+
+    InjaVisitor visitor(architecture, parser.values("tpl")[0].toStdString(),
+                        output_file.toStdString());
+
+    if (visitor.ready()) {
+      cout << visitor.visit() << endl;
+      return 0;
+    } else {
+      return 1;
+    }
+
+  } else if (parser.isSet("to-markdown")) {
+    QFileInfo src(args[0]);
+    MdVisitor visitor(architecture, src.absolutePath().toStdString());
+    auto output = visitor.visit();
+
+    cout << output;
+
+    return 0;
+  } else if (parser.isSet("to-latex")) {
+    TikzVisitor tikz(architecture);
+    auto output = tikz.visit();
+
+    cout << output;
+
+    return 0;
+  } else if (parser.isSet("to-rst")) {
+    QFileInfo src(parser.value("to-rst"));
+    RstVisitor visitor(architecture, src.absolutePath().toStdString());
+    auto output = visitor.visit();
+
+    cout << output;
+
+    return 0;
+  } else if (parser.isSet("to-ros")) {
+    QFileInfo src(parser.value("to-ros"));
+    RosVisitor visitor(architecture, src.absolutePath().toStdString());
+    auto output = visitor.visit();
+
+    cout << output;
+
+    return 0;
+  }
+  return 0;
+}
+
+// the templates used by the export, overrides included (see templates.hpp)
+QStringList export_templates(const QCommandLineParser &parser) {
+  auto overrides = QString::fromStdString(templates_dir().string());
+
+  if (parser.isSet("tpl")) {
+    QFileInfo tpl(parser.value("tpl"));
+    if (tpl.exists()) {
+      return {tpl.absoluteFilePath()};
+    }
+    return {overrides + "/" + parser.value("tpl")};
+  } else if (parser.isSet("to-markdown")) {
+    return {overrides + "/md"};
+  } else if (parser.isSet("to-rst")) {
+    return {overrides + "/rst"};
+  } else if (parser.isSet("to-ros")) {
+    return {overrides + "/ros"};
+  }
+  return {};
+}
+
+// watches a file, or a directory with its files and sub-directories (a
+// directory watch alone does not report the changes of its files)
+void watch_path(QFileSystemWatcher &watcher, const QString &path) {
+  QStringList paths;
+  if (QFileInfo(path).exists()) {
+    paths << path;
+  }
+  if (QFileInfo(path).isDir()) {
+    QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      paths << it.next();
+    }
+  }
+
+  auto watched = watcher.files() + watcher.directories();
+  for (const auto &p : paths) {
+    if (!watched.contains(p)) {
+      watcher.addPath(p);
+    }
+  }
+}
+
+// --watch: exports the model again each time its file, or one of the
+// templates of the export, is saved. The model stays loaded between exports,
+// and is only reloaded when its own file changes.
+int watch(Architecture &architecture, const QCommandLineParser &parser,
+          const QStringList &args) {
+  const auto model = QFileInfo(args[0]).absoluteFilePath();
+  const auto templates = export_templates(parser);
+
+  QFileSystemWatcher watcher;
+  auto watch_all = [&]() {
+    watch_path(watcher, model);
+    for (const auto &path : templates) {
+      watch_path(watcher, path);
+    }
+  };
+  watch_all();
+
+  // editors save in several steps (or replace the file): the changes are
+  // coalesced, and exported once the file has settled
+  QTimer settle;
+  settle.setSingleShot(true);
+  settle.setInterval(WATCH_SETTLE_MS);
+
+  bool reload = false;
+  auto changed = [&](const QString &path) {
+    reload |= path == model;
+    settle.start();
+  };
+  QObject::connect(&watcher, &QFileSystemWatcher::fileChanged, changed);
+  QObject::connect(&watcher, &QFileSystemWatcher::directoryChanged, changed);
+
+  QObject::connect(&settle, &QTimer::timeout, [&]() {
+    // a replaced file is no longer watched
+    watch_all();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (reload) {
+      reload = false;
+
+      Architecture reloaded;
+      if (!load(reloaded, model)) {
+        cerr << endl << "Keeping the previous version of the model" << endl;
+        return;
+      }
+      if (!prepare(reloaded, parser)) {
+        return;
+      }
+      architecture.replaceWith(std::move(reloaded));
+    }
+
+    try {
+      export_model(architecture, parser, args);
+    } catch (const exception &e) {
+      cerr << "Export failed: " << e.what() << endl;
+      return;
+    }
+    cerr << "Exported in " << timer.elapsed() << " ms" << endl;
+  });
+
+  cerr << "Watching " << model.toStdString();
+  for (const auto &path : templates) {
+    cerr << " and " << path.toStdString();
+  }
+  cerr << " (Ctrl+C to stop)" << endl;
+
+  return QCoreApplication::exec();
+}
+
+// the export daemon runs without the GUI, and thus without a display:
+// whether to create a QApplication has to be known before parsing the
+// command line
+unique_ptr<QCoreApplication> make_application(int &argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--daemon") == 0 ||
+        strncmp(argv[i], "--daemon=", 9) == 0) {
+      return make_unique<QCoreApplication>(argc, argv);
+    }
+  }
+  return make_unique<QApplication>(argc, argv);
+}
+
 int main(int argc, char *argv[]) {
-  QApplication app(argc, argv);
+  auto app = make_application(argc, argv);
 
   QCoreApplication::setApplicationName("boxology");
   QCoreApplication::setApplicationVersion(STR(BOXOLOGY_VERSION));
@@ -48,94 +399,149 @@ int main(int argc, char *argv[]) {
         "documentation root"},
        {{"r", "to-ros"},
         "Export the architecture to a ROS workspace",
-        "workspace root"}});
+        "workspace root"},
+       {"order",
+        "Print the nodes in startup order: each node after the nodes "
+        "connected to its inputs"},
+       {"cycles", "Print the feedback cycles, one per line"},
+       {"fan-in", "Print all the nodes a node depends on, directly or not",
+        "node name or UUID"},
+       {"fan-out",
+        "Print all the nodes that depend on a node, directly or not",
+        "node name or UUID"},
+       {"path",
+        "Print the shortest path between two nodes (give the option twice: "
+        "origin, then destination)",
+        "node name or UUID"},
+       {"flatten",
+        "Replace the nodes with a sub-architecture by the nodes of their "
+        "sub-architecture, before exporting or analysing the model"},
+       {"select",
+        "Keep only the nodes and connections matching a query (see "
+        "src/select.hpp), eg 'downstream(label:\"Social perception\")', "
+        "before exporting or analysing the model; print them otherwise",
+        "query"},
+       {"layout",
+        "Lay out the nodes automatically (in layers, from left to right along "
+        "the connections), eg for models without positions, before exporting "
+        "the model"},
+       {"diff",
+        "Print the changes between two models (JSON), matching nodes, ports "
+        "and connections across the whole hierarchy"},
+       {"merge",
+        "Three-way merge of models (base, ours, theirs): print the merged "
+        "model, and the conflicting changes on stderr"},
+       {"stats",
+        "Print the number of nodes, ports, connections and "
+        "sub-architectures of each architecture, and the approximate memory "
+        "held by the model, its strings and its JSON export (JSON)"},
+       {"watch",
+        "After exporting, keep running and export again each time the model "
+        "or the templates of the export (overrides, see the README) change"},
+       {"daemon",
+        "Run as a resident export server: read JSON requests (exports, "
+        "diffs, queries) on a local socket, one per line (see "
+        "src/app/daemon.hpp)",
+        "socket"},
+       {"trace",
+        "Record where the time goes (loading, exports, GUI) and write it to a "
+        "file, in the Chrome trace event format",
+        "file"}});
 
   // Process the actual command line arguments given by the user
-  parser.process(app);
+  parser.process(*app);
+
+  // the trace is written when main returns
+  unique_ptr<TraceSession> tracing;
+  if (parser.isSet("trace")) {
+    tracing = make_unique<TraceSession>(parser.value("trace").toStdString());
+  }
 
   auto args = parser.positionalArguments();
+
+  auto analysis = parser.isSet("order") || parser.isSet("cycles") ||
+                  parser.isSet("fan-in") || parser.isSet("fan-out") ||
+                  parser.isSet("path");
+
+  if (parser.isSet("diff") || parser.isSet("merge")) {
+    return compare(args, parser.isSet("merge"));
+  }
+
+  if (parser.isSet("daemon")) {
+    Daemon daemon;
+    if (!daemon.listen(parser.value("daemon"))) {
+      cerr << "Unable to listen on " << parser.value("daemon").toStdString()
+           << ": " << daemon.errorString().toStdString() << endl;
+      return 1;
+    }
+    cerr << "Listening on " << parser.value("daemon").toStdString() << endl;
+    return app->exec();
+  }
+
+  auto exporting = parser.isSet("to-json") || parser.isSet("tpl") ||
+                   parser.isSet("to-markdown") || parser.isSet("to-latex") ||
+                   parser.isSet("to-ros") || parser.isSet("to-rst");
+
+  // the GUI does not apply these options: fail rather than silently
+  // opening the model without them
+  auto processing = exporting || analysis || parser.isSet("stats") ||
+                    parser.isSet("select");
+  for (auto option : {"flatten", "layout"}) {
+    if (parser.isSet(option) && !processing) {
+      cerr << "--" << option << " requires an export option" << endl;
+      return 1;
+    }
+  }
+
+  // only the exports are repeated on changes
+  if (parser.isSet("watch") && !exporting) {
+    cerr << "--watch requires an export option" << endl;
+    return 1;
+  }
+
   if (args.empty()) {
     MainWindow win;
     win.show();
-    return app.exec();
+    return app->exec();
   } else {
-    if (parser.isSet("to-json") || parser.isSet("tpl") ||
-        parser.isSet("to-markdown") || parser.isSet("to-latex") ||
-        parser.isSet("to-ros") || parser.isSet("to-rst")) {
+    if (processing) {
 
       auto architecture = Architecture();
 
-      try {
-        architecture.load(args.at(0).toStdString());
-      } catch (Json::RuntimeError jre) {
-        cerr << "Unable to process the architecture: invalid JSON!";
+      if (!load(architecture, args.at(0))) {
         return 1;
-      } catch (runtime_error e) {
-        cerr << "Unable to process the architecture:" << e.what();
+      }
+
+      if (!prepare(architecture, parser)) {
         return 1;
       }
 
-      if (parser.isSet("to-json")) {
+      if (analysis) {
+        return analyze(architecture, parser);
+      } else if (parser.isSet("stats")) {
+        // builds the JSON export, to account for an exporter context
         JsonVisitor json(architecture);
-        auto output = json.visit();
+        json.visit();
 
-        cout << output;
+        Json::StyledWriter writer;
+        cout << writer.write(statistics(architecture));
 
         return 0;
-      } else if (parser.isSet("tpl")) {
-        QFileInfo src(args[0]);
-        QFileInfo tpl(parser.values("tpl")[0]);
-
-        auto output_file =
-            src.absolutePath() + "/" + src.baseName() + "." + tpl.suffix();
-
-        InjaVisitor visitor(architecture, parser.values("tpl")[0].toStdString(),
-                            output_file.toStdString());
-
-        if (visitor.ready()) {
-          visitor.visit();
-          return 0;
-        } else {
-          return 1;
-        }
-
-      } else if (parser.isSet("to-markdown")) {
-        QFileInfo src(args[0]);
-        MdVisitor visitor(architecture, src.absolutePath().toStdString());
-        auto output = visitor.visit();
-
-        cout << output;
-
-        return 0;
-      } else if (parser.isSet("to-latex")) {
-        TikzVisitor tikz(architecture);
-        auto output = tikz.visit();
-
-        cout << output;
-
-        return 0;
-      } else if (parser.isSet("to-rst")) {
-        QFileInfo src(parser.value("to-rst"));
-        RstVisitor visitor(architecture, src.absolutePath().toStdString());
-        auto output = visitor.visit();
-
-        cout << output;
-
-        return 0;
-      } else if (parser.isSet("to-ros")) {
-        QFileInfo src(parser.value("to-ros"));
-        RosVisitor visitor(architecture, src.absolutePath().toStdString());
-        auto output = visitor.visit();
-
-        cout << output;
-
+      } else if (!exporting) {
+        print_subgraph(architecture);
         return 0;
+      } else {
+        auto code = export_model(architecture, parser, args);
+        if (code != 0 || !parser.isSet("watch")) {
+          return code;
+        }
+        return watch(architecture, parser, args);
       }
     } else {
       MainWindow win;
       win.load(args.at(0).toStdString());
       win.show();
-      return app.exec();
+      return app->exec();
     }
   }
 }
@@ -6,34 +6,50 @@
         std::cerr << "[" << __FILE__ << ":" << __LINE__ << "] " << x; \
     } while (0)
 
+#include <QAbstractItemView>
+#include <QAction>
 #include <QBrush>
 #include <QButtonGroup>
 #include <QColor>
 #include <QColorDialog>
+#include <QCompleter>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QFont>
 #include <QGraphicsItem>
 #include <QGraphicsProxyWidget>
 #include <QGraphicsScene>
 #include <QGraphicsTextItem>
 #include <QGraphicsView>
+#include <QIcon>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPen>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QResizeEvent>
 #include <QStatusBar>
 #include <QString>
+#include <QStringListModel>
 #include <QSvgGenerator>
 #include <QTextEdit>
+#include <QThread>
+#include <QTimer>
+#include <QUndoStack>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <set>
+#include <vector>
 
 #include "../json/json.h"
 
 // node editor
 #include "../json_visitor.hpp"
 #include "../md_visitor.hpp"
+#include "../memory_stats.hpp"
 #include "../ros_visitor.hpp"
 #include "../tikz_visitor.hpp"
 #include "../view/cogbutton.hpp"
@@ -41,18 +57,67 @@
 #include "../view/graphicsnode.hpp"
 #include "../view/scene.hpp"
 #include "../view/view.hpp"
+#include "commands.hpp"
 #include "mainwindow.hpp"
 #include "ui_mainwindow.h"
 
 using namespace std;
 
+// Nodes are QObjects: when created by a background loader, they need to be
+// handed over to the GUI thread before being connected to their graphics
+// items.
+static void moveNodesToThread(const Architecture& architecture,
+                              QThread* thread) {
+    for (const auto& node : architecture.nodes()) {
+        node->moveToThread(thread);
+        if (node->sub_architecture) {
+            moveNodesToThread(*node->sub_architecture, thread);
+        }
+    }
+}
+
+// the line listing a search result in the search box popup, eg
+// 'input (port of face detector, in perception > faces)'
+static QString describe(const SearchResult& result) {
+    string where;
+    switch (result.kind) {
+        case SearchResult::Kind::NODE:
+            break;
+        case SearchResult::Kind::PORT:
+            where = "port of " + result.node->name();
+            break;
+        case SearchResult::Kind::CONNECTION:
+            where = "connection from " + result.node->name();
+            break;
+    }
+
+    string path;
+    for (const auto& node : result.path) {
+        path += (path.empty() ? "" : " > ") + node->name();
+    }
+    if (!path.empty()) {
+        where += (where.empty() ? "in " : ", in ") + path;
+    }
+
+    return QString::fromStdString(
+        where.empty() ? result.text : result.text + " (" + where + ")");
+}
+
 MainWindow::MainWindow()
     : _root_arch(new Architecture),
       _active_arch(_root_arch.get()),
+      _search(nullptr),
+      _search_completer(nullptr),
       ui(new Ui::MainWindow),
       _view(nullptr),
       _root_scene(nullptr),
-      _active_scene(nullptr) {
+      _active_scene(nullptr),
+      _undo_stack(new QUndoStack(this)),
+      _autosave_timer(new QTimer(this)),
+      _autosaves_since_snapshot(0),
+      _autosave_thread(new QThread(this)),
+      _autosave_worker(new QObject()),
+      _populating(false) {
     ui->setupUi(this);
 
     // create and configure scene
@@ -60,6 +125,7 @@ MainWindow::MainWindow()
         make_shared<GraphicsNodeScene>(_root_arch.get(), nullptr, this);
 
     _root_scene->setSceneRect(-32000, -32000, 64000, 64000);
+    track_scene(_root_scene.get());
 
     //  view setup
     _view = make_shared<GraphicsNodeView>(this);
@@ -78,12 +144,78 @@ MainWindow::MainWindow()
     }
 
     spawnInitialNodes();
+    _search_index.build(*_root_arch);
+
+    _undo_stack->setUndoLimit(UNDO_LIMIT);
+    auto undo = _undo_stack->createUndoAction(this);
+    undo->setIcon(QIcon::fromTheme("edit-undo"));
+    undo->setShortcuts(QKeySequence::Undo);
+    auto redo = _undo_stack->createRedoAction(this);
+    redo->setIcon(QIcon::fromTheme("edit-redo"));
+    redo->setShortcuts(QKeySequence::Redo);
+    ui->toolBar->insertActions(ui->actionFromJson, {undo, redo});
+    ui->toolBar->insertSeparator(ui->actionFromJson);
+
+    // search box, listing the matches in a popup as the user types
+    _search = new QLineEdit(this);
+    _search->setPlaceholderText(tr("Search (Ctrl+F)"));
+    _search->setClearButtonEnabled(true);
+    _search->setMaximumWidth(300);
+    ui->toolBar->addSeparator();
+    ui->toolBar->addWidget(_search);
+
+    _search_completer = new QCompleter(new QStringListModel(this), this);
+    _search_completer->setWidget(_search);
+    _search_completer->setCompletionMode(
+        QCompleter::UnfilteredPopupCompletion);
+    _search_completer->setMaxVisibleItems(SEARCH_RESULTS);
+
+    connect(_search, &QLineEdit::textEdited, this,
+            &MainWindow::onSearchEdited);
+    connect(_search_completer,
+            QOverload<const QModelIndex&>::of(&QCompleter::activated), this,
+            [this](const QModelIndex& index) {
+                if (index.row() < static_cast<int>(_search_results.size())) {
+                    jump_to(_search_results[index.row()]);
+                }
+            });
+    connect(_search, &QLineEdit::returnPressed, this, [this]() {
+        if (!_search_results.empty()) jump_to(_search_results.front());
+    });
+
+    auto find = new QAction(this);
+    find->setShortcuts(QKeySequence::Find);
+    addAction(find);
+    connect(find, &QAction::triggered, this, [this]() {
+        _search->setFocus();
+        _search->selectAll();
+    });
 
     ui->statusBar->showMessage(
         QString::fromStdString(hierarchy_name("", _root_scene.get())));
+
+    _autosave_worker->moveToThread(_autosave_thread);
+    connect(_autosave_thread, &QThread::finished, _autosave_worker,
+            &QObject::deleteLater);
+    _autosave_thread->start();
+
+    connect(_autosave_timer, &QTimer::timeout, this, &MainWindow::autosave);
+    _autosave_timer->start(AUTOSAVE_INTERVAL);
 }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow() {
+    // the loader reports to the window: stop it first
+    cancel_loading();
+
+    // let the worker complete the pending writes before stopping
+    auto autosave_thread = _autosave_thread;
+    QMetaObject::invokeMethod(
+        _autosave_worker, [autosave_thread]() { autosave_thread->quit(); },
+        Qt::QueuedConnection);
+    _autosave_thread->wait();
+
+    delete ui;
+}
 
 string MainWindow::hierarchy_name(const string& name,
                                   GraphicsNodeScene* scene) {
@@ -99,6 +231,170 @@ void MainWindow::set_active_scene(GraphicsNodeScene* scene) {
     _active_scene = scene;
     _view->setScene(scene);
     _active_arch = scene->architecture;
+
+    touch_scene(scene);
+
+    ui->actionVirtualized_view->blockSignals(true);
+    ui->actionVirtualized_view->setChecked(scene->virtualized());
+    ui->actionVirtualized_view->blockSignals(false);
+    _view->updateVisibleArea();
+}
+
+void MainWindow::push_command(QUndoCommand* command) {
+    _undo_stack->push(command);
+}
+
+GraphicsNodeScene* MainWindow::scene(const Architecture* architecture) const {
+    if (_root_scene->architecture == architecture) return _root_scene.get();
+
+    for (auto s : _visited_scenes) {
+        if (s->architecture == architecture) return s;
+    }
+    return nullptr;
+}
+
+void MainWindow::touch_scene(GraphicsNodeScene* scene) {
+    if (!scene->parent_node) return;  // the root scene is always kept
+
+    auto visited = find(_visited_scenes.begin(), _visited_scenes.end(), scene);
+    if (visited == _visited_scenes.end()) {
+        // sub-scenes are deleted with their parent node (or when released
+        // below): forget about them at that point
+        connect(scene, &QObject::destroyed, this, [this](QObject* s) {
+            _visited_scenes.remove(static_cast<GraphicsNodeScene*>(s));
+        });
+        _visited_scenes.push_front(scene);
+        track_scene(scene);
+    } else {
+        _visited_scenes.splice(_visited_scenes.begin(), _visited_scenes,
+                               visited);
+    }
+
+    // the active scene and its ancestors must not be released
+    set<GraphicsNodeScene*> in_use;
+    for (auto s = _active_scene; s;) {
+        in_use.insert(s);
+        s = s->parent_node
+                ? dynamic_cast<GraphicsNodeScene*>(s->parent_node->scene())
+                : nullptr;
+    }
+
+    size_t size = 0;
+    vector<GraphicsNodeScene*> to_release;
+    for (auto s : _visited_scenes) {
+        size += s->architecture->nodes().size() +
+                s->architecture->connections().size();
+        if (size > SUB_SCENES_CACHE_SIZE && !in_use.count(s)) {
+            to_release.push_back(s);
+        }
+    }
+
+    for (auto s : to_release) {
+        // releasing a scene also deletes its own sub-scenes: skip the ones
+        // that are already gone
+        if (find(_visited_scenes.begin(), _visited_scenes.end(), s) ==
+            _visited_scenes.end()) {
+            continue;
+        }
+        s->parent_node->releaseSubStructureScene();
+    }
+}
+
+void MainWindow::track_scene(GraphicsNodeScene* scene) {
+    auto architecture = scene->architecture;
+
+    // the indexed nodes notify the search index of their own changes: only
+    // the new ones (or the new sub-architectures) need to be added
+    connect(scene, &GraphicsNodeScene::nodeChanged, this,
+            [this, architecture](ConstNodePtr node) {
+                if (!node) return;
+                _journal.nodeChanged(*architecture, node);
+                _search_index.add(*architecture, node);
+            });
+    connect(scene, &GraphicsNodeScene::nodeRemoved, this,
+            [this, architecture](ConstNodePtr node) {
+                _journal.nodeRemoved(*architecture, node);
+                _search_index.remove(node);
+            });
+    connect(scene, &GraphicsNodeScene::portRenamed, this,
+            [this, architecture](ConstNodePtr node, const string& from,
+                                 const string& to) {
+                _journal.portRenamed(*architecture, node, from, to);
+            });
+    connect(scene, &GraphicsNodeScene::connectionChanged, this,
+            [this, architecture](ConstConnectionPtr connection) {
+                _journal.connectionChanged(*architecture, connection);
+                _search_index.add(*architecture, connection);
+            });
+    connect(scene, &GraphicsNodeScene::connectionRemoved, this,
+            [this, architecture](ConstConnectionPtr connection) {
+                _journal.connectionRemoved(*architecture, connection);
+                _search_index.remove(connection);
+            });
+}
+
+void MainWindow::autosave() {
+    // nothing to autosave next to, if the model has never been saved
+    if (_root_arch->filename.empty() || _journal.empty()) return;
+
+    auto model = _root_arch->filename;
+    auto journal = model + ".journal";
+    auto snapshot = model + ".autosave";
+
+    auto changes = _journal.take();
+    QMetaObject::invokeMethod(
+        _autosave_worker,
+        [journal, changes]() {
+            ofstream journal_file(journal, ofstream::out | ofstream::app);
+            journal_file << changes;
+        },
+        Qt::QueuedConnection);
+
+    if (++_autosaves_since_snapshot < AUTOSAVE_SNAPSHOT_PERIOD) return;
+    _autosaves_since_snapshot = 0;
+
+    // compaction, by the worker: the journal is applied to the previous
+    // snapshot (or to the model file), and the journal restarts from the
+    // resulting snapshot. The model itself is not serialized: it can be
+    // modified by the GUI thread anytime.
+    QMetaObject::invokeMethod(
+        _autosave_worker,
+        [model, journal, snapshot]() {
+            auto previous =
+                QFileInfo::exists(QString::fromStdString(snapshot)) ? snapshot
+                                                                    : model;
+            Architecture architecture;
+            try {
+                architecture.load(previous);
+                ifstream journal_file(journal);
+                Journal::replay(architecture, journal_file);
+            } catch (const exception& e) {
+                // the journal keeps growing until the next save
+                cerr << "Autosave: unable to compact " << journal << ": "
+                     << e.what() << endl;
+                return;
+            }
+
+            JsonVisitor json(architecture);
+            {
+                ofstream snapshot_file(snapshot + ".tmp", ofstream::out);
+                snapshot_file << json.visit();
+            }
+            std::rename((snapshot + ".tmp").c_str(), snapshot.c_str());
+            std::remove(journal.c_str());
+        },
+        Qt::QueuedConnection);
+}
+
+void MainWindow::remove_autosave(const string& filename) {
+    // queued after the pending autosaves
+    QMetaObject::invokeMethod(
+        _autosave_worker,
+        [filename]() {
+            std::remove((filename + ".journal").c_str());
+            std::remove((filename + ".autosave").c_str());
+        },
+        Qt::QueuedConnection);
 }
 
 void MainWindow::resizeEvent(QResizeEvent* event) {
@@ -136,6 +432,12 @@ void MainWindow::save(const std::string& filename) {
 
     json_file << output;
 
+    // the model file is now the checkpoint: the autosaves are obsolete
+    _journal.clear();
+    _autosaves_since_snapshot = 0;
+    if (!_root_arch->filename.empty()) remove_autosave(_root_arch->filename);
+    remove_autosave(filename);
+
     _root_arch->filename = filename;
 
     ui->statusBar->showMessage("Saved to " + QString::fromStdString(filename),
@@ -146,14 +448,13 @@ void MainWindow::save(const std::string& filename) {
 }
 
 void MainWindow::on_actionAdd_node_triggered() {
-    auto node = _active_arch->createNode();
+    auto node = make_shared<Node>();
 
     node->name("Node");
     node->createPort({"input", Port::Direction::IN, Port::Type::EXPLICIT});
     node->createPort({"output", Port::Direction::OUT, Port::Type::EXPLICIT});
 
-    auto gNode = _active_scene->add(node);
-    gNode->setPos(0, 0);
+    push_command(new AddNodesCommand(this, _active_arch, {node}, "Add node"));
 }
 
 void MainWindow::on_actionToJson_triggered() {
@@ -184,48 +485,271 @@ void MainWindow::on_actionFromJson_triggered() {
 }
 
 void MainWindow::load(const string& filename) {
-    try {
-        auto toaddtoremove = _root_arch->load(filename);
-        auto newstuff = toaddtoremove.first;
-        auto killedstuff = toaddtoremove.second;
+    // the scene of the previous model is still being built (see
+    // onArchitectureLoaded)
+    if (_populating) {
+        ui->statusBar->showMessage("Still loading the previous model", 2000);
+        return;
+    }
 
-        _active_scene->set_description(_root_arch->name, _root_arch->version,
-                                       _root_arch->description);
+    // unsaved changes from a previous session?
+    auto journal = filename + ".journal";
+    auto snapshot = filename + ".autosave";
+    QFileInfo model_info(QString::fromStdString(filename));
 
-        for (auto n : killedstuff.first) {
-            _active_scene->remove(n);
+    bool recover = false;
+    for (const auto& autosave : {journal, snapshot}) {
+        QFileInfo info(QString::fromStdString(autosave));
+        if (info.exists() && info.lastModified() >= model_info.lastModified()) {
+            recover = true;
+        }
+    }
+    if (recover) {
+        recover = QMessageBox::question(
+                      this, "Unsaved changes",
+                      "Changes made to this architecture were not saved. Do "
+                      "you want to recover them?") == QMessageBox::Yes;
+        if (!recover) remove_autosave(filename);
+    }
+    // the snapshot (if any) already includes the beginning of the journal
+    auto source =
+        recover && QFileInfo::exists(QString::fromStdString(snapshot))
+            ? snapshot
+            : filename;
+
+    auto progress = new QProgressDialog(
+        QString::fromStdString("Loading " + filename + "..."), "Cancel", 0,
+        100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(500);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+
+    // only one model loaded at a time
+    cancel_loading();
+
+    auto cancelled = make_shared<atomic<bool>>(false);
+    connect(progress, &QProgressDialog::canceled,
+            [cancelled]() { *cancelled = true; });
+
+    // the dialog deletes itself once closed: only used from the GUI thread,
+    // through this guard
+    QPointer<QProgressDialog> dialog(progress);
+
+    // the architecture is loaded in a separate Architecture instance, so
+    // that a failed or cancelled load does not leave us in a 'semi-loaded'
+    // state
+    auto architecture = make_shared<Architecture>();
+    auto gui_thread = thread();
+
+    auto loader = QThread::create([=]() {
+        string error;
+        int last_percent = -1;
+
+        try {
+            architecture->load(source, [&](size_t done, size_t total) {
+                if (*cancelled) return false;
+
+                int percent = total ? 100 * done / total : 100;
+                if (percent != last_percent) {
+                    last_percent = percent;
+                    QMetaObject::invokeMethod(
+                        this,
+                        [dialog, percent]() {
+                            if (dialog) dialog->setValue(percent);
+                        },
+                        Qt::QueuedConnection);
+                }
+                return true;
+            });
+
+            if (recover) {
+                ifstream journal_file(journal);
+                auto applied = Journal::replay(*architecture, journal_file);
+                DEBUG("Recovered " << applied << " changes." << endl);
+                architecture->filename = filename;
+            }
+
+            moveNodesToThread(*architecture, gui_thread);
+        } catch (LoadCancelled) {
+            DEBUG("Loading of " << filename << " cancelled." << endl);
+        } catch (Json::RuntimeError jre) {
+            error = "JSON syntax error.";
+        } catch (runtime_error e) {
+            error = e.what();
         }
 
-        DEBUG("Loaded " << newstuff.first.size() << " nodes and "
-                        << newstuff.second.size() << " connections." << endl);
+        QMetaObject::invokeMethod(
+            this,
+            [=]() {
+                if (*cancelled || !error.empty() || !dialog) {
+                    if (dialog) dialog->close();
+                    if (!error.empty()) {
+                        QMessageBox::warning(
+                            0, "Error while loading an architecture",
+                            QString::fromStdString(
+                                string("Unable to load the architecture "
+                                       "from ") +
+                                filename + ":\n\n" + error));
+                    }
+                    return;
+                }
+                onArchitectureLoaded(architecture, dialog);
+            },
+            Qt::QueuedConnection);
+    });
+
+    connect(loader, &QThread::finished, loader, &QObject::deleteLater);
+    loader->setParent(this);
+    _loader = loader;
+    _loader_cancelled = cancelled;
+    loader->start();
+}
 
-        for (auto n : newstuff.first) {
-            _active_scene->add(n);
-        }
-        for (auto c : newstuff.second) {
-            _active_scene->add(c);
-        }
-    } catch (Json::RuntimeError jre) {
-        QMessageBox::warning(
-            0, "Error while loading an architecture",
-            QString::fromStdString(
-                string("Unable to load the architecture from ") + filename +
-                ":\n\nJSON syntax error."));
-        return;
-    } catch (runtime_error e) {
-        QMessageBox::warning(
-            0, "Error while loading an architecture",
-            QString::fromStdString(
-                string("Unable to load the architecture from ") + filename +
-                ":\n\n" + e.what()));
-        return;
+void MainWindow::cancel_loading() {
+    if (!_loader) return;
+
+    // the results the loader has already posted to the window are dropped
+    // with it, or handled as a cancelled load
+    *_loader_cancelled = true;
+    _loader->wait();
+    _loader = nullptr;
+}
+
+void MainWindow::onArchitectureLoaded(shared_ptr<Architecture> architecture,
+                                      QProgressDialog* progress) {
+    // the loaded architecture replaces the root one: make sure we are not
+    // displaying a sub-architecture that is about to disappear
+    set_active_scene(_root_scene.get());
+
+    auto toaddtoremove = _root_arch->replaceWith(std::move(*architecture));
+    auto newstuff = toaddtoremove.first;
+    auto killedstuff = toaddtoremove.second;
+
+    _root_scene->set_description(_root_arch->name, _root_arch->version,
+                                 _root_arch->description);
+
+    for (auto n : killedstuff.first) {
+        _root_scene->remove(n);
     }
+
+    // large architectures are displayed in virtualized mode
+    _root_scene->setVirtualized(_root_arch->nodes().size() >
+                                VIRTUALIZATION_THRESHOLD);
+    ui->actionVirtualized_view->setChecked(_root_scene->virtualized());
+
+    DEBUG("Loaded " << newstuff.first.size() << " nodes and "
+                    << newstuff.second.size() << " connections." << endl);
+
+    // the model is now loaded: creating the graphics items can not be
+    // cancelled anymore. The dialog can still be closed (and then deletes
+    // itself) while the events are processed between batches
+    QPointer<QProgressDialog> dialog(progress);
+    dialog->setLabelText("Building the scene...");
+    dialog->setCancelButton(nullptr);
+    dialog->setRange(0, static_cast<int>(newstuff.first.size() +
+                                         newstuff.second.size()));
+
+    // the journal starts from the loaded model, and the previous changes can
+    // not be undone anymore. Both are reset before populating the scene:
+    // events are processed between batches, and the autosave timer would
+    // otherwise write the pending changes of the previous model (including
+    // the removal of its nodes) to the journal of the new one, or the user
+    // undo a change of the previous model
+    _journal.clear();
+    _undo_stack->clear();
+    _autosaves_since_snapshot = 0;
+
+    _populating = true;
+    _root_scene->populate(newstuff.first, newstuff.second,
+                          [dialog](size_t done, size_t) {
+                              if (dialog) {
+                                  dialog->setValue(static_cast<int>(done));
+                              }
+                              // keep the GUI responsive between batches
+                              QCoreApplication::processEvents();
+                          });
+    _populating = false;
+
+    _search_index.build(*_root_arch);
+
+    if (dialog) dialog->close();
+}
+
+void MainWindow::on_actionAuto_layout_triggered() {
+    push_command(new LayoutCommand(this, _active_arch));
+}
+
+void MainWindow::on_actionVirtualized_view_toggled(bool checked) {
+    _active_scene->setVirtualized(checked);
+    _view->updateVisibleArea();
+}
+
+void MainWindow::on_actionModel_statistics_triggered() {
+    auto stats = statistics(*_root_arch);
+
+    QMessageBox box(QMessageBox::Information, tr("Statistics"),
+                    QString::fromStdString(format_statistics(stats)),
+                    QMessageBox::Ok, this);
+    box.setDetailedText(
+        QString::fromStdString(format_statistics(stats, true)));
+    box.exec();
 }
 
 void MainWindow::onCogButtonTriggered(Label label) {
+    Architecture::Nodes nodes;
     for (auto node : _active_scene->selected()) {
-        node->node().lock()->label(label);
+        nodes.insert(node->node().lock());
     }
+    if (nodes.empty()) return;
+
+    push_command(new RelabelCommand(this, _active_arch, nodes, label));
+}
+
+void MainWindow::onSearchEdited(const QString& text) {
+    _search_results = _search_index.search(text.toStdString(), SEARCH_RESULTS);
+
+    QStringList lines;
+    for (const auto& result : _search_results) {
+        lines << describe(result);
+    }
+    static_cast<QStringListModel*>(_search_completer->model())
+        ->setStringList(lines);
+
+    if (lines.isEmpty()) {
+        _search_completer->popup()->hide();
+    } else {
+        _search_completer->complete();
+    }
+}
+
+void MainWindow::jump_to(const SearchResult& result) {
+    auto scene = _root_scene.get();
+    for (const auto& parent : result.path) {
+        auto item = show_node(scene, parent);
+        if (!item) return;
+        scene = item->subStructureScene();
+    }
+
+    auto item = show_node(scene, result.node);
+    if (!item) return;
+
+    scene->clearSelection();
+    item->setSelected(true);
+    _view->setFocus();
+}
+
+shared_ptr<GraphicsNode> MainWindow::show_node(GraphicsNodeScene* scene,
+                                               const ConstNodePtr& node) {
+    if (scene != _active_scene) set_active_scene(scene);
+
+    // in virtualized mode, the graphics item of the node is only created once
+    // the view displays its surroundings
+    _view->centerOn(node->x(), node->y());
+    _view->updateVisibleArea();
+
+    auto item = scene->item(node.get());
+    if (item) _view->centerOn(item.get());
+    return item;
 }
 
 void MainWindow::on_actionSave_to_SVG_triggered() {
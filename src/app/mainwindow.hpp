@@ -5,15 +5,46 @@
 
 #include <QMainWindow>
 #include <QPainterPath>
+#include <QPointer>
+#include <atomic>
+#include <list>
 #include <memory>
 
 #include "../architecture.hpp"
+#include "../journal.hpp"
 #include "../label.hpp"
+#include "../search_index.hpp"
 
+class QCompleter;
+class QLineEdit;
 class QResizeEvent;
+class QProgressDialog;
+class QThread;
+class QTimer;
+class QUndoCommand;
+class QUndoStack;
+class GraphicsNode;
 class GraphicsNodeView;
 class GraphicsNodeScene;
 
+// sub-architecture scenes are created when the user first enters them, and
+// kept around afterwards. Once the visited scenes hold more than this number
+// of nodes and connections, the least recently visited ones are released.
+const size_t SUB_SCENES_CACHE_SIZE = 10000;
+
+// the changes made to the model are appended to a journal (next to the
+// model file) every AUTOSAVE_INTERVAL ms. Every AUTOSAVE_SNAPSHOT_PERIOD
+// autosaves, the journal is compacted into a full snapshot of the model, in
+// the background (the journal applied to the previous snapshot).
+const int AUTOSAVE_INTERVAL = 10000;
+const size_t AUTOSAVE_SNAPSHOT_PERIOD = 30;
+
+// maximum number of changes that can be undone
+const int UNDO_LIMIT = 100;
+
+// maximum number of matches listed by the search box
+const int SEARCH_RESULTS = 20;
+
 namespace Ui {
 class MainWindow;
 }
@@ -26,8 +57,33 @@ class MainWindow : public QMainWindow {
     ~MainWindow();
 
     void set_active_scene(GraphicsNodeScene* scene);
+
+    /**
+     * Loads the architecture in the background, and then populates the root
+     * scene with it. A progress dialog lets the user cancel the loading; in
+     * that case (or if the loading fails), the current architecture is left
+     * untouched.
+     *
+     * If an autosave more recent than the file is found, the user is offered
+     * to recover the unsaved changes.
+     */
     void load(const std::string& filename);
 
+    /**
+     * Performs an undoable change (and takes ownership of the command).
+     */
+    void push_command(QUndoCommand* command);
+
+    /**
+     * Returns the scene currently displaying the architecture, or nullptr if
+     * there is none (eg, a sub-architecture that has not been visited yet).
+     */
+    GraphicsNodeScene* scene(const Architecture* architecture) const;
+
+    Journal& journal() { return _journal; }
+
+    SearchIndex& search_index() { return _search_index; }
+
    protected:
     virtual void resizeEvent(QResizeEvent* event);
 
@@ -41,7 +97,11 @@ class MainWindow : public QMainWindow {
     void on_actionExport_to_TikZ_triggered();
     void on_actionExport_to_Md_triggered();
     void on_actionExport_to_Ros_triggered();
+    void on_actionAuto_layout_triggered();
+    void on_actionVirtualized_view_toggled(bool checked);
+    void on_actionModel_statistics_triggered();
     void onCogButtonTriggered(Label label);
+    void onSearchEdited(const QString& text);
 
    private:
     void save(const std::string&
@@ -52,19 +112,74 @@ class MainWindow : public QMainWindow {
     void saveSvg(const QString& filename) const;
     void exportRos(const std::string& path) const;
 
+    void onArchitectureLoaded(std::shared_ptr<Architecture> architecture,
+                              QProgressDialog* progress);
+    // cancels the model being loaded, if any, and waits for its thread
+    void cancel_loading();
+
     std::string hierarchy_name(const std::string& name,
                                GraphicsNodeScene* scene);
     void spawnInitialNodes();
 
+    // marks the scene as most recently visited, and releases the least
+    // recently visited sub-scenes if needed
+    void touch_scene(GraphicsNodeScene* scene);
+
+    // records the changes made through the scene in the journal and the
+    // search index
+    void track_scene(GraphicsNodeScene* scene);
+
+    // shows a search result, entering the sub-architectures leading to it
+    void jump_to(const SearchResult& result);
+
+    // makes 'scene' the active scene, and centers the view on the node
+    // (returns its graphics item, or nullptr if the node is gone)
+    std::shared_ptr<GraphicsNode> show_node(GraphicsNodeScene* scene,
+                                            const ConstNodePtr& node);
+
+    // appends the pending changes to the journal file (or writes a full
+    // snapshot), in the background
+    void autosave();
+    void remove_autosave(const std::string& filename);
+
     std::unique_ptr<Architecture> _root_arch;
     Architecture* _active_arch;
 
+    // names across the whole hierarchy, kept up to date with the model
+    SearchIndex _search_index;
+    std::vector<SearchResult> _search_results;
+    QLineEdit* _search;
+    QCompleter* _search_completer;
+
     Ui::MainWindow* ui;
 
+    // both declared before the scenes, as they are updated while the scenes
+    // get deleted:
+    // - visited sub-scenes, most recently visited first
+    std::list<GraphicsNodeScene*> _visited_scenes;
+    // - changes not autosaved yet
+    Journal _journal;
+
     std::shared_ptr<GraphicsNodeView> _view;
     std::shared_ptr<GraphicsNodeScene> _root_scene;
     GraphicsNodeScene* _active_scene;
 
+    QUndoStack* _undo_stack;
+
+    QTimer* _autosave_timer;
+    size_t _autosaves_since_snapshot;
+    // the journal files are written by a worker living in this thread
+    QThread* _autosave_thread;
+    QObject* _autosave_worker;
+
+    // the thread loading a model, if any (see load()), and its cancellation
+    // flag. The window waits for it before being destroyed.
+    QPointer<QThread> _loader;
+    std::shared_ptr<std::atomic<bool>> _loader_cancelled;
+    // whether the scene of a loaded model is being built (events are
+    // processed in between): no other model can be loaded meanwhile
+    bool _populating;
+
     QPainterPath _path;
 
     QString _jsonPath;
@@ -5,11 +5,18 @@
 #include <fstream>
 #include <iostream>
 
+#include "arena.hpp"
 #include "label.hpp"
+#include "trace.hpp"
+#include "uuid_generator.hpp"
 #include "json/json.h"
 
 using namespace std;
 
+// rough estimate of the memory needed by a node (with its ports) or a
+// connection, to size the arena of a model; the arena grows if needed
+const size_t ARENA_BYTES_PER_OBJECT = 256;
+
 Architecture::Architecture(boost::uuids::uuid uuid)
     : uuid(uuid), name("NoName Architecture"), version("0.0.1"),
       description(
@@ -17,13 +24,13 @@ Architecture::Architecture(boost::uuids::uuid uuid)
           "article](http://example.org) with the following modifications...") {}
 
 Architecture::Architecture()
-    : Architecture(boost::uuids::random_generator()()) {}
+    : Architecture(make_uuid()) {}
 
 NodePtr Architecture::createNode(bool silent) {
   if (!silent) {
     DEBUG(name << ": creating node" << endl);
   }
-  auto node = std::make_shared<Node>();
+  auto node = make_model<Node>();
   _nodes.insert(node);
 
   return node;
@@ -33,7 +40,7 @@ NodePtr Architecture::createNode(const boost::uuids::uuid &uuid, bool silent) {
   if (!silent) {
     DEBUG(name << ": creating node (with UUID)" << endl);
   }
-  auto node = std::make_shared<Node>(uuid);
+  auto node = make_model<Node>(uuid);
   _nodes.insert(node);
 
   return node;
@@ -49,86 +56,147 @@ void Architecture::addNode(NodePtr node, bool silent) {
 }
 
 void Architecture::removeNode(NodePtr node) {
-  // first, delete all connections involving this node
-  set<ConnectionPtr> to_remove;
-  for (auto c : _connections) {
-    if (c->from.node.lock() == node || c->to.node.lock() == node) {
-      to_remove.insert(c);
+  if (!_nodes.count(node))
+    return;
+
+  // first, delete all connections involving this node (copied, as
+  // unindexConnection modifies the index)
+  auto connections = _connections_by_node.find(node.get());
+  if (connections != _connections_by_node.end()) {
+    auto to_remove = connections->second;
+    for (auto c : to_remove) {
+      unindexConnection(c);
+      _connections.erase(c);
     }
   }
-  for (auto c : to_remove)
-    _connections.erase(c);
+  _connections_by_node.erase(node.get());
 
   _nodes.erase(node);
 }
 
 NodePtr Architecture::node(const boost::uuids::uuid &uuid) {
-  for (auto n : _nodes) {
-    if (n->uuid == uuid)
-      return n;
-  }
-  return nullptr;
+  return _nodes.find(uuid);
 }
 
 ConstNodePtr Architecture::node(const boost::uuids::uuid &uuid) const {
-  for (auto n : _nodes) {
-    if (n->uuid == uuid)
-      return n;
-  }
-  return nullptr;
+  return _nodes.find(uuid);
 }
 
 ConnectionPtr Architecture::createConnection(Socket from, Socket to) {
-  auto connection = std::make_shared<Connection>();
+  auto existing = findConnection(from, to);
+  if (existing) {
+    return existing;
+  }
+
+  auto connection = make_model<Connection>();
   connection->from = from;
   connection->to = to;
 
-  for (auto c : _connections) {
-    if ((*c) == (*connection)) {
-      return c;
-    }
-  }
-
   _connections.insert(connection);
+  indexConnection(connection);
   return connection;
 }
 
 ConnectionPtr Architecture::createConnection(const boost::uuids::uuid &uuid,
                                              Socket from, Socket to) {
-  auto connection = std::make_shared<Connection>(uuid);
+  auto existing = findConnection(from, to);
+  if (existing) {
+    return existing;
+  }
+
+  auto connection = make_model<Connection>(uuid);
   connection->from = from;
   connection->to = to;
 
-  for (auto c : _connections) {
-    if ((*c) == (*connection)) {
-      return c;
-    }
+  _connections.insert(connection);
+  indexConnection(connection);
+  return connection;
+}
+
+void Architecture::addConnection(ConnectionPtr connection) {
+  if (findConnection(connection->from, connection->to)) {
+    return;
   }
 
   _connections.insert(connection);
-  return connection;
+  indexConnection(connection);
 }
 
 void Architecture::removeConnection(Socket from, Socket to) {
-  for (auto c : _connections) {
+  auto c = findConnection(from, to);
+  if (c) {
+    unindexConnection(c);
+    _connections.erase(c);
+  }
+}
+
+ConnectionPtr Architecture::findConnection(const Socket &from,
+                                           const Socket &to) const {
+  auto range = _connections_by_nodes.equal_range(
+      {from.node.lock().get(), to.node.lock().get()});
+
+  for (auto it = range.first; it != range.second; ++it) {
+    const auto &c = it->second;
     if (c->to == to && c->from == from) {
-      _connections.erase(c);
-      break;
+      return c;
+    }
+  }
+  return nullptr;
+}
+
+void Architecture::indexConnection(ConnectionPtr connection) {
+  _connections_by_nodes.insert({{connection->from.node.lock().get(),
+                                 connection->to.node.lock().get()},
+                                connection});
+  _connections_by_node[connection->from.node.lock().get()].insert(connection);
+  _connections_by_node[connection->to.node.lock().get()].insert(connection);
+}
+
+void Architecture::unindexConnection(ConnectionPtr connection) {
+  for (const auto &node : {connection->from.node, connection->to.node}) {
+    auto connections = _connections_by_node.find(node.lock().get());
+    if (connections != _connections_by_node.end()) {
+      connections->second.erase(connection);
+      if (connections->second.empty()) {
+        _connections_by_node.erase(connections);
+      }
+    }
+  }
+
+  auto range = _connections_by_nodes.equal_range(
+      {connection->from.node.lock().get(), connection->to.node.lock().get()});
+
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == connection) {
+      _connections_by_nodes.erase(it);
+      return;
     }
   }
+
+  // one of the nodes has been deleted in the meantime: fallback to a full
+  // search
+  for (auto it = _connections_by_nodes.begin();
+       it != _connections_by_nodes.end(); ++it) {
+    if (it->second == connection) {
+      _connections_by_nodes.erase(it);
+      return;
+    }
+  }
+}
+
+ConnectionPtr Architecture::connection(const boost::uuids::uuid &uuid) {
+  return _connections.find(uuid);
 }
 
 ConstConnectionPtr
 Architecture::connection(const boost::uuids::uuid &uuid) const {
-  for (auto c : _connections) {
-    if (c->uuid == uuid)
-      return c;
-  }
-  return nullptr;
+  return _connections.find(uuid);
 }
 
 const Json::Value &get_architecture(const Json::Value &root,
                                     const boost::uuids::uuid uuid) {
+  TraceScope trace("get_architecture", "model");
+
   string uuid_str(boost::lexical_cast<std::string>(uuid));
 
   for (size_t idx = 0; idx < root["architectures"].size(); idx++) {
@@ -143,12 +211,17 @@ const Json::Value &get_architecture(const Json::Value &root,
 Architecture::ToAddToRemove
 Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
                    bool clearFirst, bool recreateUUIDs, bool metadata,
-                   bool silent) {
-  set<NodePtr> newnodes;
-  set<ConnectionPtr> newconnections;
+                   bool silent, LoadMonitor *monitor) {
+  TraceScope trace("load architecture", "model");
+  if (trace.enabled()) {
+    trace.arg("uuid", boost::lexical_cast<string>(root_uuid));
+  }
+
+  Nodes newnodes;
+  Connections newconnections;
 
-  set<NodePtr> killednodes;
-  set<ConnectionPtr> killedconnections;
+  Nodes killednodes;
+  Connections killedconnections;
 
   auto root = get_architecture(json, root_uuid);
 
@@ -174,19 +247,25 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
     killedconnections = _connections;
     _nodes.clear();
     _connections.clear();
+    _connections_by_nodes.clear();
+    _connections_by_node.clear();
   }
 
-  for (auto n : _nodes) {
+  for (const auto &n : _nodes) {
     existing_uuids.insert(n->uuid);
   }
-  for (auto c : _connections) {
+  for (const auto &c : _connections) {
     existing_uuids.insert(c->uuid);
   }
 
   //////////////////////////////////////////
   /////   NODES
   //////////////////////////////////////////
-  for (auto n : root["nodes"]) {
+  for (const auto &n : root["nodes"]) {
+    if (monitor) {
+      monitor->step();
+    }
+
     auto uuid = get_uuid(n["uuid"].asString(), "Node");
 
     NodePtr node;
@@ -196,6 +275,8 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
       cerr << "Skipping this node." << endl;
       continue;
     }
+    // nodes are unique by UUID: duplicates in the file are skipped as well
+    existing_uuids.insert(uuid);
 
     if (!recreateUUIDs) {
       node = createNode(uuid);
@@ -214,17 +295,18 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
           get_uuid(n["sub_architecture"].asString(), "Architecture");
 
       if (!recreateUUIDs) {
-        node->sub_architecture.reset(new Architecture(sub_arch_uuid));
+        node->sub_architecture = make_model<Architecture>(sub_arch_uuid);
       } else {
-        node->sub_architecture.reset(new Architecture());
+        node->sub_architecture = make_model<Architecture>();
       }
       if (!silent) {
         DEBUG("Loading sub-architecture " << n["sub_architecture"].asString()
                                           << " for node "
                                           << n["name"].asString() << endl);
       }
+      node->sub_architecture->_strings = _strings;
       node->sub_architecture->load(json, sub_arch_uuid, true, recreateUUIDs,
-                                   true);
+                                   true, silent, monitor);
     }
 
     if (n.isMember("position")) {
@@ -237,7 +319,7 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
       node->height(n["size"][1].asDouble());
     }
 
-    for (auto p : n["ports"]) {
+    for (const auto &p : n["ports"]) {
       Port::Type type;
       if (p["type"].asString() == "latent")
         type = Port::Type::LATENT;
@@ -246,11 +328,15 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
       else
         type = Port::Type::OTHER;
 
-      node->createPort({p["name"].asString(),
-                        p["direction"].asString() == "in"
-                            ? Port::Direction::IN
-                            : Port::Direction::OUT,
-                        type});
+      auto port = node->createPort({_strings->intern(p["name"].asString()),
+                                    p["direction"].asString() == "in"
+                                        ? Port::Direction::IN
+                                        : Port::Direction::OUT,
+                                    type});
+      if (!port) {
+        cerr << "Duplicate port <" << p["name"].asString() << "> on node <"
+             << uuid << ">! Skipping this port." << endl;
+      }
     }
     node->name(n["name"].asString());
     newnodes.insert(node);
@@ -259,7 +345,11 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
   //////////////////////////////////////////
   /////   CONNECTIONS
   //////////////////////////////////////////
-  for (auto c : root["connections"]) {
+  for (const auto &c : root["connections"]) {
+    if (monitor) {
+      monitor->step();
+    }
+
     auto uuid = get_uuid(c["uuid"].asString(), "Connection");
 
     if (!recreateUUIDs && existing_uuids.count(uuid)) {
@@ -267,6 +357,7 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
       cerr << "Skipping this connection." << endl;
       continue;
     }
+    existing_uuids.insert(uuid);
 
     auto from_uuid_str = c["from"].asString().substr(0, 36);
     auto from_uuid = get_uuid(from_uuid_str, "Connection 'from'");
@@ -294,7 +385,8 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
                                     {to, to->port(to_port)});
     }
 
-    connection->name = c.get("name", Connection::ANONYMOUS).asString();
+    connection->name = _strings->intern(
+        c.get("name", Connection::ANONYMOUS.str()).asString());
 
     newconnections.insert(connection);
   }
@@ -302,11 +394,18 @@ Architecture::load(const Json::Value &json, const boost::uuids::uuid root_uuid,
   return {{newnodes, newconnections}, {killednodes, killedconnections}};
 }
 
-Architecture::ToAddToRemove Architecture::load(const std::string &filename) {
+Architecture::ToAddToRemove Architecture::load(const std::string &filename,
+                                               const LoadProgress &progress) {
+  TraceScope trace("Architecture::load", "model");
+  trace.arg("file", filename);
+
   Json::Value root;
   ifstream json_file(filename);
 
-  json_file >> root;
+  {
+    TraceScope parsing("parse JSON", "model");
+    json_file >> root;
+  }
 
   // 'Dummy' load to make sure the JSON is valid, without impacting the
   // current arch
@@ -320,7 +419,59 @@ Architecture::ToAddToRemove Architecture::load(const std::string &filename) {
   // from the JSON file. We can load it into ourselves.
 
   this->filename = filename;
-  return load(root, get_uuid(root["root"].asString(), "Root architecture"));
+
+  LoadMonitor monitor{progress, 0, 0};
+  for (const auto &arch : root["architectures"]) {
+    monitor.total += arch["nodes"].size() + arch["connections"].size();
+  }
+
+  // the objects of the model are allocated together, in a new arena (the
+  // objects of the previous model, if any, keep their own arena alive)
+  _arena = make_shared<Arena>(monitor.total * ARENA_BYTES_PER_OBJECT);
+  Arena::Scope scope(_arena);
+
+  // likewise, the strings of the new model are interned in a new table,
+  // shared with its sub-architectures
+  _strings = make_shared<StringTable>();
+
+  auto root_uuid = get_uuid(root["root"].asString(), "Root architecture");
+
+  if (!progress) {
+    return load(root, root_uuid);
+  }
+
+  return load(root, root_uuid, true, false, true, false, &monitor);
+}
+
+Architecture::ToAddToRemove Architecture::replaceWith(Architecture &&other) {
+  NodesAndConnections killed{_nodes, _connections};
+  NodesAndConnections added{other._nodes, other._connections};
+
+  uuid = other.uuid;
+  name = std::move(other.name);
+  version = std::move(other.version);
+  description = std::move(other.description);
+  filename = std::move(other.filename);
+
+  _arena = std::move(other._arena);
+  _strings = std::move(other._strings);
+  _nodes = std::move(other._nodes);
+  _connections = std::move(other._connections);
+  _connections_by_nodes = std::move(other._connections_by_nodes);
+  _connections_by_node = std::move(other._connections_by_node);
+
+  other._nodes.clear();
+  other._connections.clear();
+  other._connections_by_nodes.clear();
+  other._connections_by_node.clear();
+
+  return {added, killed};
+}
+
+void Architecture::LoadMonitor::step() {
+  if (!callback(done++, total)) {
+    throw LoadCancelled();
+  }
 }
 
 boost::uuids::uuid Architecture::get_uuid(const std::string &uuid,
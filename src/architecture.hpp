@@ -7,34 +7,65 @@
   } while (0)
 
 #include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
+#include <functional>
+#include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility> // for std::pair
 
 #include "connection.hpp"
 #include "node.hpp"
+#include "ordered_index.hpp"
+#include "string_table.hpp"
 
 namespace Json {
 class Value;
 }
 
+class Arena;
+
+/**
+ * Thrown by Architecture::load when the progress callback requests the
+ * loading to stop.
+ */
+struct LoadCancelled : public std::runtime_error {
+  LoadCancelled() : std::runtime_error("Loading cancelled") {}
+};
+
 class Architecture {
 public:
-  typedef std::set<NodePtr> Nodes;
-  typedef std::set<ConnectionPtr> Connections;
-  typedef std::pair<std::set<NodePtr>, std::set<ConnectionPtr>>
-      NodesAndConnections;
+  // iterated in insertion order, and indexed by UUID
+  typedef OrderedIndex<Node> Nodes;
+  typedef OrderedIndex<Connection> Connections;
+  typedef std::pair<Nodes, Connections> NodesAndConnections;
   typedef std::pair<NodesAndConnections, NodesAndConnections> ToAddToRemove;
 
+  /**
+   * Called while loading a model with the number of nodes and connections
+   * processed so far (across all the sub-architectures), and the total
+   * number of nodes and connections in the model. Returning false cancels
+   * the loading (Architecture::load then throws LoadCancelled).
+   */
+  typedef std::function<bool(size_t done, size_t total)> LoadProgress;
+
   Architecture();
   Architecture(boost::uuids::uuid uuid);
 
   bool operator=(const Architecture &arch) const { return uuid == arch.uuid; }
   bool operator<(const Architecture &arch) const { return uuid < arch.uuid; }
 
-  ToAddToRemove load(const std::string &filename);
+  ToAddToRemove load(const std::string &filename,
+                     const LoadProgress &progress = nullptr);
+
+  /**
+   * Replaces the content (nodes, connections and metadata) of this
+   * architecture by the content of 'other', typically an architecture that
+   * has been loaded in the background. 'other' is left empty.
+   */
+  ToAddToRemove replaceWith(Architecture &&other);
 
   NodePtr createNode(bool silent = false);
   NodePtr createNode(const boost::uuids::uuid &uuid, bool silent = false);
@@ -44,18 +75,24 @@ public:
   NodePtr node(const boost::uuids::uuid &uuid);
   ConstNodePtr node(const boost::uuids::uuid &uuid) const;
 
-  Nodes nodes() { return _nodes; }
-  const Nodes nodes() const { return _nodes; }
+  // no copy: the nodes and connections must not be added or removed while
+  // iterating over them
+  const Nodes &nodes() const { return _nodes; }
 
   ConnectionPtr createConnection(Socket from, Socket to);
   ConnectionPtr createConnection(const boost::uuids::uuid &uuid, Socket from,
                                  Socket to);
 
+  /**
+   * Adds back a connection previously removed from this architecture (its
+   * nodes must be part of the architecture).
+   */
+  void addConnection(ConnectionPtr connection);
   void removeConnection(Socket from, Socket to);
 
-  Connections connections() { return _connections; }
-  const Connections connections() const { return _connections; }
+  const Connections &connections() const { return _connections; }
 
+  ConnectionPtr connection(const boost::uuids::uuid &uuid);
   ConstConnectionPtr connection(const boost::uuids::uuid &uuid) const;
 
   boost::uuids::uuid uuid;
@@ -66,13 +103,44 @@ public:
   std::string filename;
 
 private:
+  struct LoadMonitor {
+    const LoadProgress &callback;
+    size_t done;
+    size_t total;
+
+    void step();
+  };
+
   ToAddToRemove load(const Json::Value &json, const boost::uuids::uuid uuid,
                      bool clearFirst = true, bool recreateUUIDs = false,
-                     bool metadata = true, bool silent = false);
+                     bool metadata = true, bool silent = false,
+                     LoadMonitor *monitor = nullptr);
+
+  ConnectionPtr findConnection(const Socket &from, const Socket &to) const;
+  void indexConnection(ConnectionPtr connection);
+  void unindexConnection(ConnectionPtr connection);
+
+  // the nodes, ports, connections and sub-architectures created by load()
+  // are allocated in this arena
+  std::shared_ptr<Arena> _arena;
+
+  // the port and connection names of the loaded model are interned in this
+  // table, shared by the whole hierarchy of architectures
+  std::shared_ptr<StringTable> _strings;
 
   Nodes _nodes;
   Connections _connections;
 
+  // connections indexed by the pair of nodes they link, to find duplicates
+  // without scanning every connection
+  std::multimap<std::pair<const Node *, const Node *>, ConnectionPtr>
+      _connections_by_nodes;
+
+  // connections indexed by each of the nodes they link, to remove the
+  // connections of a node without scanning every connection
+  std::unordered_map<const Node *, std::set<ConnectionPtr>>
+      _connections_by_node;
+
   boost::uuids::uuid get_uuid(const std::string &uuid,
                               const std::string &ctxt = "");
 };
@@ -0,0 +1,24 @@
+#include "arena.hpp"
+
+using namespace std;
+
+namespace {
+thread_local shared_ptr<Arena> current_arena;
+}
+
+Arena::Arena(size_t initial_size)
+    : _upstream(MemoryCategory::MODEL),
+      _resource(initial_size > 0 ? initial_size : 1024, &_upstream) {}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    return _resource.allocate(bytes, alignment);
+}
+
+Arena::Scope::Scope(shared_ptr<Arena> arena)
+    : _previous(std::move(current_arena)) {
+    current_arena = std::move(arena);
+}
+
+Arena::Scope::~Scope() { current_arena = std::move(_previous); }
+
+const shared_ptr<Arena>& Arena::current() { return current_arena; }
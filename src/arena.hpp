@@ -0,0 +1,111 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+#include "memory_stats.hpp"
+
+/**
+ * Memory arena for the model objects (nodes, ports, connections,
+ * sub-architectures) created while loading a model.
+ *
+ * The objects are allocated one after the other in large blocks, in the
+ * order they are loaded, instead of being scattered by individual heap
+ * allocations. Freeing an object does not return its memory: all the
+ * blocks are released at once, when the arena is destroyed.
+ *
+ * The objects remain reference-counted as usual: each of them holds a
+ * reference to its arena, so that the arena lives as long as the
+ * architecture that created it, or as long as any of its objects is still
+ * used elsewhere (eg, kept by the undo stack).
+ *
+ * The blocks are accounted as MemoryCategory::MODEL (see MemoryStats), as
+ * are the objects created outside of an arena.
+ *
+ * An arena is not thread-safe: it must only be used (through a Scope) by
+ * the thread that loads the model.
+ */
+class Arena {
+   public:
+    explicit Arena(size_t initial_size = 0);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    /**
+     * While a Scope is alive, make_model() allocates the objects created by
+     * the current thread in 'arena'. Scopes can be nested.
+     */
+    class Scope {
+       public:
+        explicit Scope(std::shared_ptr<Arena> arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        std::shared_ptr<Arena> _previous;
+    };
+
+    // the arena of the innermost Scope of this thread, if any
+    static const std::shared_ptr<Arena>& current();
+
+   private:
+    // must outlive _resource, which returns its blocks on destruction
+    CountingResource _upstream;
+    std::pmr::monotonic_buffer_resource _resource;
+};
+
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    explicit ArenaAllocator(std::shared_ptr<Arena> arena)
+        : arena(std::move(arena)) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // the memory is released with the arena
+    void deallocate(T*, size_t) {}
+
+    std::shared_ptr<Arena> arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& l, const ArenaAllocator<U>& r) {
+    return l.arena == r.arena;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& l, const ArenaAllocator<U>& r) {
+    return !(l == r);
+}
+
+/**
+ * Creates a model object, in the current arena if there is one (see
+ * Arena::Scope), on the heap otherwise.
+ */
+template <class T, class... Args>
+std::shared_ptr<T> make_model(Args&&... args) {
+    const auto& arena = Arena::current();
+    if (!arena) {
+        return make_counted<T>(MemoryCategory::MODEL,
+                               std::forward<Args>(args)...);
+    }
+
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena),
+                                   std::forward<Args>(args)...);
+}
+
+#endif  // ARENA_HPP
@@ -5,7 +5,7 @@
 
 using namespace std;
 
-const string Connection::ANONYMOUS = "anonymous";
+const Name Connection::ANONYMOUS = "anonymous";
 
 Connection::~Connection() {
     // qWarning() << "Connection " << QString::fromStdString(name) << "
@@ -4,11 +4,11 @@
 #define CONNECTION_HPP
 
 #include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
 #include <memory>
 #include <string>
 
 #include "node.hpp"
+#include "uuid_generator.hpp"
 
 struct Socket {
     NodeWeakPtr node;
@@ -26,9 +26,9 @@ inline bool operator==(const Socket& l, const Socket& r) {
  */
 struct Connection {
    public:
-    static const std::string ANONYMOUS;
+    static const Name ANONYMOUS;
 
-    Connection() : uuid(boost::uuids::random_generator()()), name(ANONYMOUS){};
+    Connection() : uuid(make_uuid()), name(ANONYMOUS){};
 
     Connection(const boost::uuids::uuid& uuid) : uuid(uuid), name(ANONYMOUS){};
 
@@ -42,7 +42,7 @@ struct Connection {
 
     boost::uuids::uuid uuid;
 
-    std::string name;
+    Name name;
     Socket from, to;
     std::string desc;
 };
@@ -0,0 +1,662 @@
+#include "diff.hpp"
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "label.hpp"
+
+using namespace std;
+
+typedef Change::Kind Kind;
+typedef Change::Operation Operation;
+
+namespace {
+
+const size_t UUID_LENGTH = 36;
+
+// the 'owner' of the root architecture
+const boost::uuids::uuid ROOT = boost::uuids::nil_uuid();
+
+template <class T>
+using ByUUID = unordered_map<boost::uuids::uuid, T,
+                             boost::hash<boost::uuids::uuid>>;
+
+string to_id(const boost::uuids::uuid &uuid) {
+  return uuid.is_nil() ? "" : boost::uuids::to_string(uuid);
+}
+
+boost::uuids::uuid to_uuid(const string &id) {
+  return id.empty() ? ROOT : boost::uuids::string_generator()(id);
+}
+
+string socket_id(const Socket &socket) {
+  return to_id(socket.node.lock()->uuid) + ":" +
+         socket.port.lock()->name.str();
+}
+
+bool same_socket(const Socket &a, const Socket &b) {
+  return a.node.lock()->uuid == b.node.lock()->uuid &&
+         a.port.lock()->name == b.port.lock()->name;
+}
+
+/**
+ * An object of a model: the architecture owned by a node (the root
+ * architecture is owned by ROOT), a node, a port of a node, a connection.
+ */
+struct Item {
+  Kind kind;
+  boost::uuids::uuid uuid;
+  Name port;
+
+  string id() const {
+    return kind == Kind::PORT ? to_id(uuid) + ":" + port.str() : to_id(uuid);
+  }
+};
+
+/**
+ * The objects of a whole hierarchy of architectures (A is Architecture, or
+ * const Architecture), indexed by UUID, and listed in hierarchy order.
+ */
+template <class A> class Index {
+public:
+  struct NodeEntry {
+    NodePtr node;
+    A *parent;
+    boost::uuids::uuid owner;
+  };
+
+  struct ConnectionEntry {
+    ConnectionPtr connection;
+    A *parent;
+    boost::uuids::uuid owner;
+  };
+
+  explicit Index(A &root) { add(root, ROOT); }
+
+  void add(A &architecture, const boost::uuids::uuid &owner) {
+    architectures[owner] = &architecture;
+    order.push_back({Kind::ARCHITECTURE, owner, {}});
+
+    for (const auto &node : architecture.nodes()) {
+      add(node, architecture, owner);
+    }
+    for (const auto &connection : architecture.connections()) {
+      connections[connection->uuid] = {connection, &architecture, owner};
+      order.push_back({Kind::CONNECTION, connection->uuid, {}});
+    }
+  }
+
+  void add(const NodePtr &node, A &parent, const boost::uuids::uuid &owner) {
+    nodes[node->uuid] = {node, &parent, owner};
+    order.push_back({Kind::NODE, node->uuid, {}});
+
+    for (const auto &port : node->ports()) {
+      order.push_back({Kind::PORT, node->uuid, port->name});
+    }
+    if (node->sub_architecture) {
+      add(*node->sub_architecture, node->uuid);
+    }
+  }
+
+  // removes a node, and the content of its sub-architecture, from the index
+  void forget(const NodePtr &node) {
+    nodes.erase(node->uuid);
+    if (node->sub_architecture) {
+      forget(*node->sub_architecture, node->uuid);
+    }
+  }
+
+  void forget(A &architecture, const boost::uuids::uuid &owner) {
+    architectures.erase(owner);
+    for (const auto &node : architecture.nodes()) {
+      forget(node);
+    }
+    for (const auto &connection : architecture.connections()) {
+      connections.erase(connection->uuid);
+    }
+  }
+
+  NodePtr node(const boost::uuids::uuid &uuid) const {
+    auto entry = nodes.find(uuid);
+    return entry == nodes.end() ? nullptr : entry->second.node;
+  }
+
+  PortPtr port(const Item &item) const {
+    auto owner = node(item.uuid);
+    return owner ? owner->port(item.port) : nullptr;
+  }
+
+  bool has(const Item &item) const {
+    switch (item.kind) {
+    case Kind::ARCHITECTURE:
+      return architectures.count(item.uuid);
+    case Kind::NODE:
+      return nodes.count(item.uuid);
+    case Kind::PORT:
+      return port(item) != nullptr;
+    case Kind::CONNECTION:
+      return connections.count(item.uuid);
+    }
+    return false;
+  }
+
+  // whether an object present in both indexes has the same fields in both
+  // (faster than comparing their descriptions)
+  bool same(const Item &item, const Index &other) const {
+    switch (item.kind) {
+    case Kind::ARCHITECTURE: {
+      auto a = architectures.at(item.uuid);
+      auto b = other.architectures.at(item.uuid);
+      return a->uuid == b->uuid && a->name == b->name &&
+             a->version == b->version && a->description == b->description;
+    }
+    case Kind::NODE: {
+      const auto &a = nodes.at(item.uuid);
+      const auto &b = other.nodes.at(item.uuid);
+      return a.owner == b.owner && a.node->name() == b.node->name() &&
+             a.node->label() == b.node->label() &&
+             a.node->x() == b.node->x() && a.node->y() == b.node->y() &&
+             a.node->width() == b.node->width() &&
+             a.node->height() == b.node->height();
+    }
+    case Kind::PORT:
+      return port(item)->direction == other.port(item)->direction;
+    case Kind::CONNECTION: {
+      const auto &a = connections.at(item.uuid);
+      const auto &b = other.connections.at(item.uuid);
+      return a.owner == b.owner &&
+             a.connection->name == b.connection->name &&
+             same_socket(a.connection->from, b.connection->from) &&
+             same_socket(a.connection->to, b.connection->to);
+    }
+    }
+    return false;
+  }
+
+  // the fields of an object, as stored in the change sets
+  Json::Value describe(const Item &item) const {
+    Json::Value fields(Json::objectValue);
+
+    switch (item.kind) {
+    case Kind::ARCHITECTURE: {
+      auto architecture = architectures.at(item.uuid);
+      fields["uuid"] = to_id(architecture->uuid);
+      fields["name"] = architecture->name;
+      fields["version"] = architecture->version;
+      fields["description"] = architecture->description;
+      break;
+    }
+    case Kind::NODE: {
+      const auto &entry = nodes.at(item.uuid);
+      fields["name"] = entry.node->name();
+      fields["label"] = LABEL_NAMES.at(entry.node->label());
+      fields["position"].append(entry.node->x());
+      fields["position"].append(entry.node->y());
+      fields["size"].append(entry.node->width());
+      fields["size"].append(entry.node->height());
+      fields["parent"] = to_id(entry.owner);
+      break;
+    }
+    case Kind::PORT:
+      fields["direction"] =
+          port(item)->direction == Port::Direction::IN ? "in" : "out";
+      break;
+    case Kind::CONNECTION: {
+      const auto &entry = connections.at(item.uuid);
+      fields["name"] = entry.connection->name.str();
+      fields["from"] = socket_id(entry.connection->from);
+      fields["to"] = socket_id(entry.connection->to);
+      fields["parent"] = to_id(entry.owner);
+      break;
+    }
+    }
+    return fields;
+  }
+
+  vector<Item> order;
+
+  ByUUID<A *> architectures;
+  ByUUID<NodeEntry> nodes;
+  ByUUID<ConnectionEntry> connections;
+};
+
+/**
+ * Applies the changes of a change set to a model, as long as they are
+ * consistent with its current content.
+ */
+class Patcher {
+public:
+  explicit Patcher(Architecture &architecture) : _index(architecture) {}
+
+  bool apply(const Change &change) {
+    switch (change.kind) {
+    case Kind::ARCHITECTURE:
+      return applyToArchitecture(change);
+    case Kind::NODE:
+      return applyToNode(change);
+    case Kind::PORT:
+      return applyToPort(change);
+    case Kind::CONNECTION:
+      return applyToConnection(change);
+    }
+    return false;
+  }
+
+private:
+  bool applyToArchitecture(const Change &change) {
+    auto owner = _index.node(to_uuid(change.id));
+
+    switch (change.operation) {
+    case Operation::ADD:
+      if (!owner || owner->sub_architecture) {
+        return false;
+      }
+      owner->sub_architecture =
+          make_shared<Architecture>(to_uuid(change.to["uuid"].asString()));
+      for (const auto &field : change.to.getMemberNames()) {
+        setField(*owner->sub_architecture, field, change.to[field]);
+      }
+      _index.architectures[owner->uuid] = owner->sub_architecture.get();
+      return true;
+
+    case Operation::REMOVE:
+      // the root architecture can not be removed
+      if (!owner) {
+        return !change.id.empty();
+      }
+      if (owner->sub_architecture) {
+        _index.forget(*owner->sub_architecture, owner->uuid);
+        owner->sub_architecture = nullptr;
+      }
+      return true;
+
+    case Operation::MODIFY: {
+      auto architecture = _index.architectures.find(to_uuid(change.id));
+      if (architecture == _index.architectures.end()) {
+        return false;
+      }
+      setField(*architecture->second, change.field, change.to);
+      return true;
+    }
+    }
+    return false;
+  }
+
+  void setField(Architecture &architecture, const string &field,
+                const Json::Value &value) {
+    if (field == "uuid") {
+      architecture.uuid = to_uuid(value.asString());
+    } else if (field == "name") {
+      architecture.name = value.asString();
+    } else if (field == "version") {
+      architecture.version = value.asString();
+    } else if (field == "description") {
+      architecture.description = value.asString();
+    }
+  }
+
+  bool applyToNode(const Change &change) {
+    auto entry = _index.nodes.find(to_uuid(change.id));
+
+    switch (change.operation) {
+    case Operation::ADD: {
+      auto parent =
+          _index.architectures.find(to_uuid(change.to["parent"].asString()));
+      if (entry != _index.nodes.end() ||
+          parent == _index.architectures.end()) {
+        return false;
+      }
+      auto node = parent->second->createNode(to_uuid(change.id), true);
+      for (const auto &field : change.to.getMemberNames()) {
+        if (field != "parent") {
+          setField(*node, field, change.to[field]);
+        }
+      }
+      _index.nodes[node->uuid] = {node, parent->second, parent->first};
+      return true;
+    }
+
+    case Operation::REMOVE:
+      if (entry != _index.nodes.end()) {
+        auto node = entry->second.node;
+        entry->second.parent->removeNode(node);
+        _index.forget(node);
+      }
+      return true;
+
+    case Operation::MODIFY:
+      if (entry == _index.nodes.end()) {
+        return false;
+      }
+      if (change.field == "parent") {
+        return move(entry->second, to_uuid(change.to.asString()));
+      }
+      setField(*entry->second.node, change.field, change.to);
+      return true;
+    }
+    return false;
+  }
+
+  void setField(Node &node, const string &field, const Json::Value &value) {
+    if (field == "name") {
+      node.name(value.asString());
+    } else if (field == "label") {
+      node.label(get_label_by_name(value.asString()));
+    } else if (field == "position") {
+      node.x(value[0].asDouble());
+      node.y(value[1].asDouble());
+    } else if (field == "size") {
+      node.width(value[0].asDouble());
+      node.height(value[1].asDouble());
+    }
+  }
+
+  // moves a node to the architecture owned by 'owner' (its connections stay
+  // behind, and are removed)
+  bool move(Index<Architecture>::NodeEntry &entry,
+            const boost::uuids::uuid &owner) {
+    auto parent = _index.architectures.find(owner);
+    if (parent == _index.architectures.end() ||
+        parent->second->node(entry.node->uuid)) {
+      return false;
+    }
+    entry.parent->removeNode(entry.node);
+    parent->second->addNode(entry.node, true);
+    entry.parent = parent->second;
+    entry.owner = owner;
+    return true;
+  }
+
+  bool applyToPort(const Change &change) {
+    auto node = _index.node(to_uuid(change.id.substr(0, UUID_LENGTH)));
+    auto name = change.id.substr(UUID_LENGTH + 1);
+    auto direction = [](const Json::Value &value) {
+      return value.asString() == "in" ? Port::Direction::IN
+                                      : Port::Direction::OUT;
+    };
+
+    switch (change.operation) {
+    case Operation::ADD:
+      return node && node->createPort({name, direction(change.to["direction"]),
+                                       Port::Type::OTHER}) != nullptr;
+
+    case Operation::REMOVE:
+      if (node && node->port(name)) {
+        node->remove_port(node->port(name));
+      }
+      return true;
+
+    case Operation::MODIFY:
+      if (!node || !node->port(name)) {
+        return false;
+      }
+      if (change.field == "direction") {
+        node->port(name)->direction = direction(change.to);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool applyToConnection(const Change &change) {
+    auto entry = _index.connections.find(to_uuid(change.id));
+
+    switch (change.operation) {
+    case Operation::ADD: {
+      auto parent =
+          _index.architectures.find(to_uuid(change.to["parent"].asString()));
+      Socket from, to;
+      if (entry != _index.connections.end() ||
+          parent == _index.architectures.end() ||
+          !socket(*parent->second, change.to["from"].asString(), from) ||
+          !socket(*parent->second, change.to["to"].asString(), to)) {
+        return false;
+      }
+      auto connection =
+          parent->second->createConnection(to_uuid(change.id), from, to);
+      if (to_id(connection->uuid) != change.id) {
+        // these ports are already connected
+        return false;
+      }
+      connection->name = change.to["name"].asString();
+      _index.connections[connection->uuid] = {connection, parent->second,
+                                              parent->first};
+      return true;
+    }
+
+    case Operation::REMOVE:
+      if (entry != _index.connections.end()) {
+        auto connection = entry->second.connection;
+        entry->second.parent->removeConnection(connection->from,
+                                               connection->to);
+        _index.connections.erase(entry);
+      }
+      return true;
+
+    case Operation::MODIFY: {
+      if (entry == _index.connections.end()) {
+        return false;
+      }
+      auto &connection = entry->second.connection;
+      if (change.field == "name") {
+        connection->name = change.to.asString();
+        return true;
+      }
+
+      // another end, or another architecture: the connection is removed,
+      // then added back
+      auto parent = _index.architectures.find(
+          change.field == "parent" ? to_uuid(change.to.asString())
+                                   : entry->second.owner);
+      if (parent == _index.architectures.end()) {
+        return false;
+      }
+      auto from = connection->from;
+      auto to = connection->to;
+      if ((change.field == "from" &&
+           !socket(*parent->second, change.to.asString(), from)) ||
+          (change.field == "to" &&
+           !socket(*parent->second, change.to.asString(), to))) {
+        return false;
+      }
+      entry->second.parent->removeConnection(connection->from,
+                                             connection->to);
+      connection->from = from;
+      connection->to = to;
+      parent->second->addConnection(connection);
+      entry->second.parent = parent->second;
+      entry->second.owner = parent->first;
+      return true;
+    }
+    }
+    return false;
+  }
+
+  // resolves a '<node UUID>:<port name>' socket, within 'architecture'
+  bool socket(Architecture &architecture, const string &id, Socket &socket) {
+    auto node = _index.nodes.find(to_uuid(id.substr(0, UUID_LENGTH)));
+    if (node == _index.nodes.end() || node->second.parent != &architecture) {
+      return false;
+    }
+    auto port = node->second.node->port(id.substr(UUID_LENGTH + 1));
+    if (!port) {
+      return false;
+    }
+    socket = {node->second.node, port};
+    return true;
+  }
+
+  Index<Architecture> _index;
+};
+
+string key(const Change &change) {
+  return to_string(static_cast<int>(change.kind)) + ":" + change.id + ":" +
+         change.field;
+}
+
+string key(Kind kind, const string &id) {
+  return to_string(static_cast<int>(kind)) + ":" + id + ":";
+}
+
+} // namespace
+
+ChangeSet diff(const Architecture &from, const Architecture &to) {
+  Index<const Architecture> before(from);
+  Index<const Architecture> after(to);
+
+  ChangeSet changes;
+
+  auto removal = [&](const Item &item) {
+    changes.push_back({Operation::REMOVE, item.kind, item.id(), "",
+                       before.describe(item), Json::Value()});
+  };
+
+  // first, the connections that would prevent removing their ports...
+  for (const auto &item : before.order) {
+    if (item.kind == Kind::CONNECTION && !after.has(item)) {
+      removal(item);
+    }
+  }
+
+  // ...then the additions and modifications, in hierarchy order...
+  for (const auto &item : after.order) {
+    if (!before.has(item)) {
+      changes.push_back({Operation::ADD, item.kind, item.id(), "",
+                         Json::Value(), after.describe(item)});
+      continue;
+    }
+    if (before.same(item, after)) {
+      continue;
+    }
+
+    auto old_fields = before.describe(item);
+    auto new_fields = after.describe(item);
+    for (const auto &field : new_fields.getMemberNames()) {
+      if (old_fields[field] != new_fields[field]) {
+        changes.push_back({Operation::MODIFY, item.kind, item.id(), field,
+                           old_fields[field], new_fields[field]});
+      }
+    }
+  }
+
+  // ...and the other removals, the content of the nodes before the nodes
+  for (auto item = before.order.rbegin(); item != before.order.rend();
+       ++item) {
+    if (item->kind != Kind::CONNECTION && !after.has(*item)) {
+      removal(*item);
+    }
+  }
+
+  return changes;
+}
+
+ChangeSet merge(const Architecture &base, Architecture &ours,
+                const Architecture &theirs) {
+  // what 'ours' changed, by (kind, id, field), and the objects it touched
+  // (changed, or used by a change)
+  unordered_map<string, const Change *> our_changes;
+  unordered_set<string> touched;
+
+  auto touch_parent = [&](const Json::Value &parent) {
+    touched.insert(key(Kind::ARCHITECTURE, parent.asString()));
+    touched.insert(key(Kind::NODE, parent.asString()));
+  };
+  auto touch_socket = [&](const Json::Value &socket) {
+    touched.insert(key(Kind::PORT, socket.asString()));
+    touched.insert(key(Kind::NODE, socket.asString().substr(0, UUID_LENGTH)));
+  };
+
+  auto our_diff = diff(base, ours);
+  for (const auto &change : our_diff) {
+    our_changes[key(change)] = &change;
+    touched.insert(key(change.kind, change.id));
+
+    if (change.kind == Kind::PORT) {
+      touched.insert(key(Kind::NODE, change.id.substr(0, UUID_LENGTH)));
+    }
+
+    if (change.operation == Operation::ADD) {
+      if (change.to.isMember("parent")) {
+        touch_parent(change.to["parent"]);
+      }
+      if (change.kind == Kind::CONNECTION) {
+        touch_socket(change.to["from"]);
+        touch_socket(change.to["to"]);
+      }
+    } else if (change.operation == Operation::MODIFY) {
+      if (change.field == "parent") {
+        touch_parent(change.to);
+      } else if (change.kind == Kind::CONNECTION &&
+                 (change.field == "from" || change.field == "to")) {
+        touch_socket(change.to);
+      }
+    }
+  }
+
+  Patcher patcher(ours);
+  ChangeSet conflicts;
+
+  for (const auto &change : diff(base, theirs)) {
+    auto our_change = our_changes.find(key(change));
+    if (our_change != our_changes.end()) {
+      // both sides made the same change
+      if (our_change->second->operation == change.operation &&
+          our_change->second->to == change.to) {
+        continue;
+      }
+      conflicts.push_back(change);
+      continue;
+    }
+
+    auto removed = our_changes.find(key(change.kind, change.id));
+    if ((change.operation == Operation::MODIFY &&
+         removed != our_changes.end() &&
+         removed->second->operation == Operation::REMOVE) ||
+        (change.operation == Operation::REMOVE &&
+         touched.count(key(change.kind, change.id)))) {
+      conflicts.push_back(change);
+      continue;
+    }
+
+    if (!patcher.apply(change)) {
+      conflicts.push_back(change);
+    }
+  }
+
+  return conflicts;
+}
+
+Json::Value toJson(const ChangeSet &changes) {
+  static const map<Operation, string> OPERATIONS{
+      {Operation::ADD, "add"},
+      {Operation::REMOVE, "remove"},
+      {Operation::MODIFY, "modify"}};
+  static const map<Kind, string> KINDS{{Kind::ARCHITECTURE, "architecture"},
+                                       {Kind::NODE, "node"},
+                                       {Kind::PORT, "port"},
+                                       {Kind::CONNECTION, "connection"}};
+
+  Json::Value json(Json::arrayValue);
+
+  for (const auto &change : changes) {
+    Json::Value jchange;
+    jchange["operation"] = OPERATIONS.at(change.operation);
+    jchange["kind"] = KINDS.at(change.kind);
+    jchange["id"] = change.id;
+    if (change.operation == Operation::MODIFY) {
+      jchange["field"] = change.field;
+    }
+    if (change.operation != Operation::ADD) {
+      jchange["from"] = change.from;
+    }
+    if (change.operation != Operation::REMOVE) {
+      jchange["to"] = change.to;
+    }
+    json.append(jchange);
+  }
+  return json;
+}
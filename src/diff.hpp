@@ -0,0 +1,73 @@
+#ifndef DIFF_HPP
+#define DIFF_HPP
+
+#include <string>
+#include <vector>
+
+#include "architecture.hpp"
+#include "json/json.h"
+
+/**
+ * One structural change between two versions of a model.
+ *
+ * Objects are identified across the whole hierarchy of sub-architectures:
+ * - nodes and connections by UUID;
+ * - ports by '<node UUID>:<port name>' (the notation of the connections in
+ *   the JSON files);
+ * - architectures by the UUID of the node that owns them, or "" for the
+ *   root architecture.
+ *
+ * Additions carry the whole new object in 'to', removals the whole removed
+ * object in 'from'. Modifications carry the old and new value of one
+ * 'field' of the object. Moving a node or a connection to another
+ * sub-architecture is a modification of its 'parent' field (the UUID of the
+ * node owning the architecture it belongs to).
+ */
+struct Change {
+  enum class Kind { ARCHITECTURE, NODE, PORT, CONNECTION };
+  enum class Operation { ADD, REMOVE, MODIFY };
+
+  Operation operation;
+  Kind kind;
+  std::string id;
+
+  std::string field;
+  Json::Value from;
+  Json::Value to;
+};
+
+typedef std::vector<Change> ChangeSet;
+
+/**
+ * Returns the changes turning 'from' into 'to', in an order suitable to
+ * apply them one after the other (the connections are removed first, the
+ * nodes and ports last; a new sub-architecture is added after the node that
+ * owns it, and before its nodes).
+ *
+ * Runs in linear time (the objects of both models are indexed in hash
+ * maps).
+ */
+ChangeSet diff(const Architecture &from, const Architecture &to);
+
+/**
+ * Three-way merge: applies to 'ours' the changes from 'base' to 'theirs'.
+ *
+ * The changes conflicting with the changes from 'base' to 'ours' are not
+ * applied (the version of 'ours' is kept), and are returned:
+ * - a modification of the same field, to another value;
+ * - an addition of the same object, with other values;
+ * - a removal of an object that 'ours' modified, or added something to
+ *   (ports, connections, sub-nodes), or the modification of an object that
+ *   'ours' removed;
+ * - any change that can not be applied to 'ours' (eg, a connection to a
+ *   node that 'ours' removed).
+ */
+ChangeSet merge(const Architecture &base, Architecture &ours,
+                const Architecture &theirs);
+
+/**
+ * Returns the machine-readable (JSON) form of a change set.
+ */
+Json::Value toJson(const ChangeSet &changes);
+
+#endif // DIFF_HPP
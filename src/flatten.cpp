@@ -0,0 +1,166 @@
+#include "flatten.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/name_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+class Flattener {
+public:
+  explicit Flattener(Architecture &flat) : _flat(flat) {}
+
+  void flatten(const Architecture &architecture, const string &prefix,
+               double x, double y) {
+    for (const auto &node : architecture.nodes()) {
+      if (expanded(node)) {
+        flatten(*node->sub_architecture, prefix + node->name() + "/",
+                x + node->x(), y + node->y());
+        indexBoundary(node);
+      } else {
+        copy(node, prefix, x, y);
+      }
+    }
+
+    for (const auto &connection : architecture.connections()) {
+      rewire(connection);
+    }
+  }
+
+private:
+  typedef vector<Socket> Sockets;
+
+  static bool expanded(const ConstNodePtr &node) {
+    return node->sub_architecture && !node->sub_architecture->nodes().empty();
+  }
+
+  void copy(const ConstNodePtr &node, const string &prefix, double x,
+            double y) {
+    auto leaf = _flat.createNode(node->uuid, true);
+    leaf->name(prefix + node->name());
+    leaf->label(node->label());
+    leaf->x(x + node->x());
+    leaf->y(y + node->y());
+    leaf->width(node->width());
+    leaf->height(node->height());
+    // the sub-architecture of a leaf is empty, but the exporters use its
+    // metadata (description,...)
+    leaf->sub_architecture = node->sub_architecture;
+
+    for (const auto &port : node->ports()) {
+      leaf->createPort(*port);
+    }
+    _leaves[node.get()] = leaf;
+  }
+
+  // the nodes of the sub-architecture of 'node' are already flattened:
+  // records the sockets inside that each port of 'node' leads to
+  void indexBoundary(const ConstNodePtr &node) {
+    auto &boundary = _boundaries[node.get()];
+    for (const auto &inner : node->sub_architecture->nodes()) {
+      for (const auto &port : inner->ports()) {
+        auto &sockets = boundary[{port->name, port->direction}];
+        auto resolved = resolve(inner.get(), port->name, port->direction);
+        sockets.insert(sockets.end(), resolved.begin(), resolved.end());
+      }
+    }
+  }
+
+  // the sockets of the flat architecture corresponding to a port of an
+  // original node
+  Sockets resolve(const Node *node, const string &port,
+                  Port::Direction direction) const {
+    auto leaf = _leaves.find(node);
+    if (leaf != _leaves.end()) {
+      return {{leaf->second, leaf->second->port(port)}};
+    }
+
+    auto boundary = _boundaries.find(node);
+    if (boundary == _boundaries.end()) {
+      return {};
+    }
+    auto sockets = boundary->second.find({port, direction});
+    if (sockets == boundary->second.end()) {
+      return {};
+    }
+    return sockets->second;
+  }
+
+  void rewire(const ConstConnectionPtr &connection) {
+    auto from_node = connection->from.node.lock();
+    auto from_port = connection->from.port.lock();
+    auto to_node = connection->to.node.lock();
+    auto to_port = connection->to.port.lock();
+    if (!from_node || !from_port || !to_node || !to_port) {
+      return;
+    }
+
+    auto froms =
+        resolve(from_node.get(), from_port->name, from_port->direction);
+    auto tos = resolve(to_node.get(), to_port->name, to_port->direction);
+
+    if (froms.empty() || tos.empty()) {
+      cerr << "No port matching the connection <" << connection->uuid
+           << "> (" << from_node->name() << ":" << from_port->name << " -> "
+           << to_node->name() << ":" << to_port->name
+           << ") inside its sub-architecture! ";
+      cerr << "Skipping this connection." << endl;
+      return;
+    }
+
+    auto rewired = expanded(from_node) || expanded(to_node);
+
+    for (const auto &from : froms) {
+      for (const auto &to : tos) {
+        // rewired connections get UUIDs derived from the original one and
+        // from their ends, so that flattening is reproducible
+        auto uuid = connection->uuid;
+        if (rewired) {
+          boost::uuids::name_generator generator(connection->uuid);
+          uuid = generator(
+              boost::lexical_cast<string>(from.node.lock()->uuid) + ":" +
+              from.port.lock()->name.str() + "->" +
+              boost::lexical_cast<string>(to.node.lock()->uuid) + ":" +
+              to.port.lock()->name.str());
+        }
+        auto flat = _flat.createConnection(uuid, from, to);
+        flat->name = connection->name;
+      }
+    }
+  }
+
+  Architecture &_flat;
+
+  // copies of the leaf nodes of the hierarchy
+  unordered_map<const Node *, NodePtr> _leaves;
+
+  // for each replaced node, the sockets inside, by port name and direction
+  typedef pair<string, Port::Direction> PortKey;
+  struct PortKeyHash {
+    size_t operator()(const PortKey &key) const {
+      return hash<string>()(key.first) ^ static_cast<size_t>(key.second);
+    }
+  };
+  unordered_map<const Node *, unordered_map<PortKey, Sockets, PortKeyHash>>
+      _boundaries;
+};
+
+} // namespace
+
+unique_ptr<Architecture> flatten(const Architecture &architecture) {
+  unique_ptr<Architecture> flat(new Architecture(architecture.uuid));
+  flat->name = architecture.name;
+  flat->version = architecture.version;
+  flat->description = architecture.description;
+  flat->filename = architecture.filename;
+
+  Flattener(*flat).flatten(architecture, "", 0, 0);
+
+  return flat;
+}
@@ -0,0 +1,29 @@
+#ifndef FLATTEN_HPP
+#define FLATTEN_HPP
+
+#include <memory>
+
+#include "architecture.hpp"
+
+/**
+ * Returns a flat copy of the whole hierarchy of 'architecture': every node
+ * with a (non-empty) sub-architecture is replaced by the content of its
+ * sub-architecture, recursively.
+ *
+ * - the nodes are copies of the leaf nodes of the hierarchy, with the same
+ *   UUIDs, and names qualified by the names of their ancestors (eg,
+ *   'perception/face detector'). Their positions are offset by the
+ *   positions of their ancestors.
+ * - connections to a port of a replaced node are rewired to the ports with
+ *   the same name and direction of the nodes inside (a connection might
+ *   then become several). Connections that can not be rewired (no such port
+ *   inside) are dropped.
+ *
+ * The copy is built in a single pass, linear in the total number of nodes,
+ * ports and connections of the hierarchy, and is independent from the
+ * original: it can be kept and reused (by several exporters, for graph
+ * analysis,...) as long as the original is not modified.
+ */
+std::unique_ptr<Architecture> flatten(const Architecture &architecture);
+
+#endif // FLATTEN_HPP
@@ -0,0 +1,311 @@
+#include "graph.hpp"
+
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+const Graph::Index NONE = numeric_limits<Graph::Index>::max();
+}
+
+Graph::Graph(const Architecture &architecture) {
+  _nodes.reserve(architecture.nodes().size());
+  for (const auto &node : architecture.nodes()) {
+    _indices[node.get()] = _nodes.size();
+    _nodes.push_back(node);
+  }
+
+  vector<pair<Index, Index>> edges;
+  edges.reserve(architecture.connections().size());
+  for (const auto &connection : architecture.connections()) {
+    auto from = _indices.find(connection->from.node.lock().get());
+    auto to = _indices.find(connection->to.node.lock().get());
+    if (from == _indices.end() || to == _indices.end()) {
+      continue;
+    }
+    edges.push_back({from->second, to->second});
+  }
+
+  // counting sort of the edges by source (resp. target) node
+  auto n = _nodes.size();
+  _successor_offsets.assign(n + 1, 0);
+  _predecessor_offsets.assign(n + 1, 0);
+  for (const auto &e : edges) {
+    _successor_offsets[e.first + 1]++;
+    _predecessor_offsets[e.second + 1]++;
+  }
+  for (size_t i = 0; i < n; i++) {
+    _successor_offsets[i + 1] += _successor_offsets[i];
+    _predecessor_offsets[i + 1] += _predecessor_offsets[i];
+  }
+
+  _successors.resize(edges.size());
+  _predecessors.resize(edges.size());
+  auto next_successor = _successor_offsets;
+  auto next_predecessor = _predecessor_offsets;
+  for (const auto &e : edges) {
+    _successors[next_successor[e.first]++] = e.second;
+    _predecessors[next_predecessor[e.second]++] = e.first;
+  }
+}
+
+Graph::Index Graph::index(const ConstNodePtr &node) const {
+  auto it = _indices.find(node.get());
+  if (it == _indices.end()) {
+    throw runtime_error("Node <" + node->name() +
+                        "> is not part of the graph");
+  }
+  return it->second;
+}
+
+Graph::NodeList Graph::toNodes(const vector<Index> &indices) const {
+  NodeList nodes;
+  nodes.reserve(indices.size());
+  for (auto i : indices) {
+    nodes.push_back(_nodes[i]);
+  }
+  return nodes;
+}
+
+vector<vector<Graph::Index>> Graph::components() const {
+  auto n = _nodes.size();
+
+  vector<Index> order(n, NONE); // discovery order
+  vector<Index> low(n, NONE);
+  vector<bool> on_stack(n, false);
+  vector<Index> stack;
+
+  // iterative depth-first search (recursing would overflow the call stack
+  // on long chains of nodes): each entry is a node, and the position of the
+  // next successor to visit
+  vector<pair<Index, Index>> calls;
+
+  vector<vector<Index>> result;
+  Index discovered = 0;
+
+  for (Index start = 0; start < n; start++) {
+    if (order[start] != NONE) {
+      continue;
+    }
+
+    order[start] = low[start] = discovered++;
+    stack.push_back(start);
+    on_stack[start] = true;
+    calls.push_back({start, _successor_offsets[start]});
+
+    while (!calls.empty()) {
+      auto v = calls.back().first;
+      auto &next = calls.back().second;
+
+      if (next < _successor_offsets[v + 1]) {
+        auto w = _successors[next++];
+        if (order[w] == NONE) {
+          order[w] = low[w] = discovered++;
+          stack.push_back(w);
+          on_stack[w] = true;
+          calls.push_back({w, _successor_offsets[w]});
+        } else if (on_stack[w]) {
+          low[v] = min(low[v], order[w]);
+        }
+        continue;
+      }
+
+      calls.pop_back();
+      if (!calls.empty()) {
+        auto parent = calls.back().first;
+        low[parent] = min(low[parent], low[v]);
+      }
+
+      if (low[v] == order[v]) {
+        vector<Index> component;
+        Index w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          on_stack[w] = false;
+          component.push_back(w);
+        } while (w != v);
+        reverse(component.begin(), component.end());
+        result.push_back(move(component));
+      }
+    }
+  }
+
+  // Tarjan's algorithm completes the components in reverse topological
+  // order
+  reverse(result.begin(), result.end());
+  return result;
+}
+
+bool Graph::acyclic() const {
+  for (Index i = 0; i < _nodes.size(); i++) {
+    for (auto j = _successor_offsets[i]; j < _successor_offsets[i + 1]; j++) {
+      if (_successors[j] == i) {
+        return false;
+      }
+    }
+  }
+
+  for (const auto &component : components()) {
+    if (component.size() > 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Graph::NodeList Graph::topologicalOrder() const {
+  NodeList result;
+  result.reserve(_nodes.size());
+  for (const auto &component : components()) {
+    for (auto i : component) {
+      result.push_back(_nodes[i]);
+    }
+  }
+  return result;
+}
+
+vector<Graph::NodeList> Graph::stronglyConnectedComponents() const {
+  vector<NodeList> result;
+  for (const auto &component : components()) {
+    result.push_back(toNodes(component));
+  }
+  return result;
+}
+
+vector<Graph::NodeList> Graph::cycles() const {
+  vector<NodeList> result;
+  for (const auto &component : components()) {
+    auto cyclic = component.size() > 1;
+
+    if (!cyclic) {
+      auto i = component.front();
+      for (auto j = _successor_offsets[i]; j < _successor_offsets[i + 1];
+           j++) {
+        cyclic = cyclic || _successors[j] == i;
+      }
+    }
+
+    if (cyclic) {
+      result.push_back(toNodes(component));
+    }
+  }
+  return result;
+}
+
+vector<Graph::Index> Graph::traverse(Index start, const vector<Index> &offsets,
+                                     const vector<Index> &targets,
+                                     vector<Index> *parents) const {
+  vector<bool> visited(_nodes.size(), false);
+  if (parents) {
+    parents->assign(_nodes.size(), NONE);
+  }
+
+  // the reached nodes double as the queue of the breadth-first search
+  vector<Index> reached{start};
+  visited[start] = true;
+
+  for (size_t head = 0; head < reached.size(); head++) {
+    auto v = reached[head];
+    for (auto i = offsets[v]; i < offsets[v + 1]; i++) {
+      auto w = targets[i];
+      if (visited[w]) {
+        continue;
+      }
+      visited[w] = true;
+      if (parents) {
+        (*parents)[w] = v;
+      }
+      reached.push_back(w);
+    }
+  }
+
+  reached.erase(reached.begin());
+  return reached;
+}
+
+Graph::NodeList Graph::fanIn(const ConstNodePtr &node) const {
+  return toNodes(traverse(index(node), _predecessor_offsets, _predecessors));
+}
+
+Graph::NodeList Graph::fanOut(const ConstNodePtr &node) const {
+  return toNodes(traverse(index(node), _successor_offsets, _successors));
+}
+
+vector<Graph::Index> Graph::reach(const NodeList &starts,
+                                  const vector<Index> &offsets,
+                                  const vector<Index> &targets) const {
+  unordered_set<Index> visited;
+  vector<Index> reached;
+  for (const auto &node : starts) {
+    auto i = index(node);
+    if (visited.insert(i).second) {
+      reached.push_back(i);
+    }
+  }
+
+  for (size_t head = 0; head < reached.size(); head++) {
+    auto v = reached[head];
+    for (auto i = offsets[v]; i < offsets[v + 1]; i++) {
+      if (visited.insert(targets[i]).second) {
+        reached.push_back(targets[i]);
+      }
+    }
+  }
+  return reached;
+}
+
+Graph::NodeList Graph::upstream(const NodeList &nodes) const {
+  return toNodes(reach(nodes, _predecessor_offsets, _predecessors));
+}
+
+Graph::NodeList Graph::downstream(const NodeList &nodes) const {
+  return toNodes(reach(nodes, _successor_offsets, _successors));
+}
+
+Graph::NodeList Graph::shortestPath(const ConstNodePtr &from,
+                                    const ConstNodePtr &to) const {
+  auto source = index(from);
+  auto target = index(to);
+
+  if (source == target) {
+    return {from};
+  }
+
+  vector<Index> parents;
+  traverse(source, _successor_offsets, _successors, &parents);
+
+  if (parents[target] == NONE) {
+    return {};
+  }
+
+  vector<Index> path{target};
+  while (path.back() != source) {
+    path.push_back(parents[path.back()]);
+  }
+  reverse(path.begin(), path.end());
+  return toNodes(path);
+}
+
+ConstNodePtr find_node(const Architecture &architecture, const string &id) {
+  try {
+    auto node =
+        architecture.node(boost::lexical_cast<boost::uuids::uuid>(id));
+    if (node) {
+      return node;
+    }
+  } catch (const boost::bad_lexical_cast &) {
+  }
+
+  for (const auto &node : architecture.nodes()) {
+    if (node->name() == id) {
+      return node;
+    }
+  }
+  throw runtime_error("No node named <" + id + ">");
+}
@@ -0,0 +1,117 @@
+#ifndef GRAPH_HPP
+#define GRAPH_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "architecture.hpp"
+
+/**
+ * Graph analysis of the nodes of an architecture (not including the content
+ * of the sub-architectures), the connections being directed from their
+ * 'from' node to their 'to' node.
+ *
+ * The graph is a snapshot of the architecture at construction time, stored
+ * as compact adjacency arrays (CSR): every operation runs in linear time in
+ * the number of nodes and connections. Changes made to the architecture
+ * afterwards are not reflected.
+ */
+class Graph {
+public:
+  typedef uint32_t Index;
+  typedef std::vector<ConstNodePtr> NodeList;
+
+  explicit Graph(const Architecture &architecture);
+
+  size_t size() const { return _nodes.size(); }
+
+  /**
+   * True if there is no cycle (including connections from a node to
+   * itself).
+   */
+  bool acyclic() const;
+
+  /**
+   * Returns all the nodes, each of them after the nodes connected to its
+   * inputs, eg to start them in order. The nodes that are part of a cycle
+   * have no such order: they are kept together, at the position of the
+   * cycle in the order.
+   */
+  NodeList topologicalOrder() const;
+
+  /**
+   * Returns the strongly connected components of the graph (Tarjan's
+   * algorithm), in topological order. Components of more than one node
+   * are feedback cycles.
+   */
+  std::vector<NodeList> stronglyConnectedComponents() const;
+
+  /**
+   * The strongly connected components that contain a cycle (ie, with
+   * several nodes, or a single node connected to itself).
+   */
+  std::vector<NodeList> cycles() const;
+
+  /**
+   * All the nodes 'node' depends on (resp. that depend on 'node'),
+   * directly or not, closest ones first. 'node' itself is not included.
+   */
+  NodeList fanIn(const ConstNodePtr &node) const;
+  NodeList fanOut(const ConstNodePtr &node) const;
+
+  /**
+   * The nodes, and all the nodes they depend on (resp. that depend on
+   * them), directly or not. Unlike fanIn/fanOut, runs in time proportional
+   * to the result (and the connections of its nodes), not to the graph.
+   */
+  NodeList upstream(const NodeList &nodes) const;
+  NodeList downstream(const NodeList &nodes) const;
+
+  /**
+   * One of the shortest paths (in number of connections) from 'from' to
+   * 'to', both included. Empty if 'to' can not be reached from 'from'.
+   */
+  NodeList shortestPath(const ConstNodePtr &from,
+                        const ConstNodePtr &to) const;
+
+private:
+  Index index(const ConstNodePtr &node) const;
+
+  std::vector<std::vector<Index>> components() const;
+
+  // breadth-first traversal from 'start' along the given adjacency arrays;
+  // 'parents' (if not null) receives the predecessor of each reached node
+  std::vector<Index> traverse(Index start, const std::vector<Index> &offsets,
+                              const std::vector<Index> &targets,
+                              std::vector<Index> *parents = nullptr) const;
+
+  // breadth-first traversal from several nodes, visiting only the reached
+  // nodes (the starts included)
+  std::vector<Index> reach(const NodeList &starts,
+                           const std::vector<Index> &offsets,
+                           const std::vector<Index> &targets) const;
+
+  NodeList toNodes(const std::vector<Index> &indices) const;
+
+  NodeList _nodes;
+  std::unordered_map<const Node *, Index> _indices;
+
+  // the successors of the node i are _successors[_successor_offsets[i]]
+  // to _successors[_successor_offsets[i + 1] - 1] (and likewise for the
+  // predecessors)
+  std::vector<Index> _successor_offsets;
+  std::vector<Index> _successors;
+  std::vector<Index> _predecessor_offsets;
+  std::vector<Index> _predecessors;
+};
+
+/**
+ * Finds a node of the architecture (not of its sub-architectures) by UUID,
+ * or else by name. Throws a runtime_error if there is no such node.
+ */
+ConstNodePtr find_node(const Architecture &architecture,
+                       const std::string &id);
+
+#endif // GRAPH_HPP
@@ -6,8 +6,8 @@
 
 #include <curl/curl.h>
 
-#include <QStandardPaths>
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <memory>
 #include <nlohmann/json_fwd.hpp>
@@ -17,6 +17,8 @@
 #include "inja/inja.hpp"
 #include "label.hpp"
 #include "node.hpp"
+#include "templates.hpp"
+#include "trace.hpp"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -35,16 +37,18 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
 
 InjaVisitor::InjaVisitor(const Architecture &architecture,
                          const string &input_tpl, const string &output_path)
-    : Visitor(architecture), input_tpl(input_tpl), output_path(output_path) {
+    : Visitor(architecture), graph_(architecture), input_tpl(input_tpl),
+      output_path(output_path) {
   fs::path tpl_path;
 
-  if (!fs::exists(input_tpl)) {
+  // falls back on the shipped templates (eg tikz_dvisvgm_tpl.tex)
+  if (!fs::exists(input_tpl) && !has_template(input_tpl)) {
 
-    cerr << "[EE] Template " << input_tpl << " not found!" << endl;
+    export_log() << "[EE] Template " << input_tpl << " not found!";
     return;
   }
 
-  cerr << "Using template " << input_tpl << endl;
+  export_log() << "Using template " << input_tpl;
   env_ = make_unique<inja::Environment>(fs::current_path().string() + "/",
                                         fs::path(output_path).parent_path());
 
@@ -65,10 +69,7 @@ InjaVisitor::InjaVisitor(const Architecture &architecture,
   });
 
   env_->add_callback("make_anchor", 1, [this](inja::Arguments &args) {
-    auto raw = args.at(0)->get<string>();
-    // replace all non-alphanumeric characters with '-'
-    std::regex re("[^a-zA-Z0-9]");
-    return std::regex_replace(raw, re, "-");
+    return this->make_anchor(args.at(0)->get<string>());
   });
 
   env_->add_callback("substr", 3, [](inja::Arguments &args) {
@@ -80,6 +81,22 @@ InjaVisitor::InjaVisitor(const Architecture &architecture,
     auto raw = args.at(0)->get<string>();
     return this->tex_escape(raw);
   });
+
+  env_->add_callback("fan_in", 1, [this](inja::Arguments &args) {
+    auto node = this->get_node_by_id(args.at(0)->get<string>());
+    if (!node) {
+      return nlohmann::json::array();
+    }
+    return nlohmann::json(this->get_ids(graph_.fanIn(node)));
+  });
+
+  env_->add_callback("fan_out", 1, [this](inja::Arguments &args) {
+    auto node = this->get_node_by_id(args.at(0)->get<string>());
+    if (!node) {
+      return nlohmann::json::array();
+    }
+    return nlohmann::json(this->get_ids(graph_.fanOut(node)));
+  });
 }
 
 void InjaVisitor::startUp() {
@@ -106,6 +123,25 @@ void InjaVisitor::tearDown() {
     return;
   }
 
+  // the nodes in startup order (each node after the nodes it depends on),
+  // eg to order the entries of a launch file, and the feedback cycles
+  auto startup_order = get_ids(graph_.topologicalOrder());
+  data_["startup_order"] = startup_order;
+
+  map<string, size_t> ranks;
+  size_t rank = 0;
+  for (const auto &id : startup_order) {
+    ranks[id] = rank++;
+  }
+  for (auto &node : data_["nodes"]) {
+    node["startup_rank"] = ranks[node["id"].get<string>()];
+  }
+
+  data_["cycles"] = nlohmann::json::array();
+  for (const auto &cycle : graph_.cycles()) {
+    data_["cycles"].push_back(get_ids(cycle));
+  }
+
   std::sort(data_["nodes"].begin(), data_["nodes"].end(),
             [](const nlohmann::json &n1, const nlohmann::json &n2) -> bool {
               return n1["id"] < n2["id"];
@@ -115,14 +151,17 @@ void InjaVisitor::tearDown() {
               return e1["id"] < e2["id"];
             });
 
-  cerr << "Generating " << output_path << " using " << input_tpl << "..."
-       << endl;
-  auto tpl = env_->parse_template(input_tpl);
-  // env_->write(tpl, data_, output_path);
-  auto out = env_->render(tpl, data_);
-  cout << out << endl;
+  export_log() << "Generating " << output_path << " using " << input_tpl
+               << "...";
+  auto tpl = traced("parse_template", "template", [&]() {
+    return fs::exists(input_tpl) ? env_->parse_template(input_tpl)
+                                 : env_->parse(load_template(input_tpl));
+  });
+  // the caller prints or writes the document (see visit())
+  _content = traced("render", "template",
+                    [&]() { return env_->render(tpl, data_); });
 
-  cerr << "Generation complete: " << output_path << endl;
+  export_log() << "Generation complete: " << output_path;
 }
 
 void InjaVisitor::beginNodes() {}
@@ -177,6 +216,8 @@ void InjaVisitor::onNode(shared_ptr<const Node> node) {
           curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
           curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
           curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+          TraceScope trace("FETCH_DOC", "network");
+          trace.arg("url", url);
           res = curl_easy_perform(curl);
           jnode["description"] = readBuffer;
           continue;
@@ -234,7 +275,7 @@ void InjaVisitor::onNode(shared_ptr<const Node> node) {
 
     bool isInput = (p->direction == Port::Direction::IN);
 
-    auto name = p->name;
+    auto name = p->name.str();
     jport["name"] = name;
 
     regex topic_regex("^(/.*) \\[(.*)\\]$", regex_constants::ECMAScript);
@@ -253,10 +294,11 @@ void InjaVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cerr << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "subscribes to" : "publishes") << " topic "
-           << jport["topic"] << " (short: " << jport["short"] << ") of type "
-           << jport["type"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "subscribes to" : "publishes") << " topic "
+                   << jport["topic"] << " (short: " << jport["short"]
+                   << ") of type "
+                   << jport["type"];
 
     } else if (regex_search(name, tf_matches, tf_regex)) {
       jport["type"] = "tf";
@@ -271,9 +313,9 @@ void InjaVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cerr << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "listen to" : "broadcasts") << " TF frame "
-           << jport["frame"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "listen to" : "broadcasts") << " TF frame "
+                   << jport["frame"];
     } else {
       jport["type"] = "undefined";
       auto id = make_id(name);
@@ -319,7 +361,7 @@ void InjaVisitor::onConnection(shared_ptr<const Connection> connection) {
   auto [from_id, from_id_capitalized] = get_id(from->uuid);
   auto [to_id, to_id_capitalized] = get_id(to->uuid);
 
-  auto name = connection->name;
+  auto name = connection->name.str();
   trim(name);
   if (name == "anonymous") {
     name = "";
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "architecture.hpp" // Node
+#include "graph.hpp"
 #include "label.hpp"
 #include "node.hpp"
 #include "visitor.hpp"
@@ -26,10 +27,15 @@ private:
   void beginConnections() override;
   void onConnection(std::shared_ptr<const Connection>) override;
   void tearDown() override;
+  size_t context_size() const override {
+    return approximate_json_size(data_);
+  }
 
 private:
   std::vector<ConstNodePtr> nodes_;
 
+  Graph graph_;
+
   std::string input_tpl;
   std::string output_path;
 
@@ -0,0 +1,329 @@
+#include "journal.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <set>
+#include <sstream>
+
+#include "label.hpp"
+#include "json/json.h"
+
+using namespace std;
+
+namespace {
+
+string uuid_str(const boost::uuids::uuid& uuid) {
+    return boost::lexical_cast<string>(uuid);
+}
+
+boost::uuids::uuid to_uuid(const string& uuid) {
+    return boost::lexical_cast<boost::uuids::uuid>(uuid);
+}
+
+// same format as the JsonVisitor, without the content of the
+// sub-architecture
+Json::Value to_json(ConstNodePtr node) {
+    Json::Value jnode;
+    jnode["uuid"] = uuid_str(node->uuid);
+    jnode["name"] = node->name();
+    jnode["label"] = LABEL_NAMES.at(node->label());
+    jnode["position"].append(node->x());
+    jnode["position"].append(node->y());
+    jnode["size"].append(node->width());
+    jnode["size"].append(node->height());
+
+    if (node->sub_architecture) {
+        jnode["sub_architecture"] = uuid_str(node->sub_architecture->uuid);
+    }
+
+    for (const auto& port : node->ports()) {
+        Json::Value jport;
+        jport["name"] = port->name.str();
+        jport["direction"] =
+            (port->direction == Port::Direction::IN ? "in" : "out");
+        jnode["ports"].append(jport);
+    }
+    return jnode;
+}
+
+Json::Value to_json(ConstConnectionPtr connection) {
+    auto from = connection->from.node.lock();
+    auto to = connection->to.node.lock();
+
+    Json::Value jconn;
+    jconn["uuid"] = uuid_str(connection->uuid);
+    jconn["name"] = connection->name.str();
+    jconn["from"] =
+        uuid_str(from->uuid) + ":" + connection->from.port.lock()->name.str();
+    jconn["to"] =
+        uuid_str(to->uuid) + ":" + connection->to.port.lock()->name.str();
+    return jconn;
+}
+
+Json::Value operation(const string& op, const boost::uuids::uuid& arch) {
+    Json::Value jop;
+    jop["op"] = op;
+    jop["architecture"] = uuid_str(arch);
+    return jop;
+}
+
+// all the architectures of the hierarchy, indexed by UUID
+void collect(Architecture& architecture,
+             map<boost::uuids::uuid, Architecture*>& architectures) {
+    architectures[architecture.uuid] = &architecture;
+    for (const auto& node : architecture.nodes()) {
+        if (node->sub_architecture) {
+            collect(*node->sub_architecture, architectures);
+        }
+    }
+}
+
+// "<node uuid>:<port name>", as written by to_json(ConstConnectionPtr)
+Socket to_socket(Architecture& architecture, const string& endpoint) {
+    auto node = architecture.node(to_uuid(endpoint.substr(0, 36)));
+    if (!node) return {};
+
+    return {node, node->port(endpoint.substr(37))};
+}
+
+void apply_node(Architecture& architecture, const Json::Value& jnode,
+                map<boost::uuids::uuid, Architecture*>& architectures) {
+    auto uuid = to_uuid(jnode["uuid"].asString());
+
+    auto node = architecture.node(uuid);
+    if (!node) {
+        node = architecture.createNode(uuid, true);
+    }
+
+    node->name(jnode["name"].asString());
+    node->label(get_label_by_name(jnode.get("label", "").asString()));
+    node->x(jnode["position"][0].asDouble());
+    node->y(jnode["position"][1].asDouble());
+    node->width(jnode["size"][0].asDouble());
+    node->height(jnode["size"][1].asDouble());
+
+    if (!jnode.get("sub_architecture", "").asString().empty() &&
+        !node->sub_architecture) {
+        node->sub_architecture.reset(
+            new Architecture(to_uuid(jnode["sub_architecture"].asString())));
+        node->sub_architecture->name = node->name();
+        architectures[node->sub_architecture->uuid] =
+            node->sub_architecture.get();
+    }
+
+    set<string> ports;
+    for (auto p : jnode["ports"]) {
+        auto name = p["name"].asString();
+        ports.insert(name);
+
+        if (!node->port(name)) {
+            node->createPort({name,
+                              p["direction"].asString() == "in"
+                                  ? Port::Direction::IN
+                                  : Port::Direction::OUT,
+                              Port::Type::OTHER});
+        }
+    }
+    // copied, as remove_port modifies the ports of the node
+    auto existing = node->ports();
+    for (auto p : existing) {
+        if (!ports.count(p->name)) node->remove_port(p);
+    }
+}
+
+void apply_connection(Architecture& architecture, const Json::Value& jconn) {
+    auto uuid = to_uuid(jconn["uuid"].asString());
+
+    auto from = to_socket(architecture, jconn["from"].asString());
+    auto to = to_socket(architecture, jconn["to"].asString());
+    if (from.port.expired() || to.port.expired()) return;
+
+    auto connection = architecture.connection(uuid);
+    if (connection && !(connection->from == from && connection->to == to)) {
+        architecture.removeConnection(connection->from, connection->to);
+        connection = nullptr;
+    }
+    if (!connection) {
+        // replaces another connection between the same ports, if any (eg,
+        // replaying a journal written before removals were journaled first)
+        architecture.removeConnection(from, to);
+        connection = architecture.createConnection(uuid, from, to);
+    }
+    connection->name =
+        jconn.get("name", Connection::ANONYMOUS.str()).asString();
+}
+
+// returns false if the operation refers to an architecture that does not
+// exist (yet)
+bool apply(const Json::Value& jop,
+           map<boost::uuids::uuid, Architecture*>& architectures) {
+    auto arch = architectures.find(to_uuid(jop["architecture"].asString()));
+    if (arch == architectures.end()) return false;
+
+    auto& architecture = *arch->second;
+    auto op = jop["op"].asString();
+
+    if (op == "node") {
+        apply_node(architecture, jop["node"], architectures);
+    } else if (op == "remove_node") {
+        auto node = architecture.node(to_uuid(jop["uuid"].asString()));
+        if (node) architecture.removeNode(node);
+    } else if (op == "rename_port") {
+        auto node = architecture.node(to_uuid(jop["node"].asString()));
+        if (node) {
+            auto port = node->port(jop["from"].asString());
+            if (port) node->rename_port(port, jop["to"].asString());
+        }
+    } else if (op == "connection") {
+        apply_connection(architecture, jop["connection"]);
+    } else if (op == "remove_connection") {
+        auto connection =
+            architecture.connection(to_uuid(jop["uuid"].asString()));
+        if (connection) {
+            architecture.removeConnection(connection->from, connection->to);
+        }
+    } else {
+        throw runtime_error("Unknown journal operation: " + op);
+    }
+    return true;
+}
+
+}  // namespace
+
+void Journal::nodeChanged(const Architecture& architecture,
+                          ConstNodePtr node) {
+    _removed_nodes.erase(node->uuid);
+    _changed_nodes[node->uuid] = {architecture.uuid, node};
+}
+
+void Journal::nodeRemoved(const Architecture& architecture,
+                          ConstNodePtr node) {
+    _changed_nodes.erase(node->uuid);
+    _removed_nodes[node->uuid] = architecture.uuid;
+}
+
+void Journal::portRenamed(const Architecture& architecture, ConstNodePtr node,
+                          const string& from, const string& to) {
+    _renamed_ports.emplace_back(architecture.uuid, node->uuid, from, to);
+    nodeChanged(architecture, node);
+}
+
+void Journal::connectionChanged(const Architecture& architecture,
+                                ConstConnectionPtr connection) {
+    _removed_connections.erase(connection->uuid);
+    _changed_connections[connection->uuid] = {architecture.uuid, connection};
+}
+
+void Journal::connectionRemoved(const Architecture& architecture,
+                                ConstConnectionPtr connection) {
+    _changed_connections.erase(connection->uuid);
+    _removed_connections[connection->uuid] = architecture.uuid;
+}
+
+bool Journal::empty() const {
+    return _changed_nodes.empty() && _removed_nodes.empty() &&
+           _changed_connections.empty() && _removed_connections.empty() &&
+           _renamed_ports.empty();
+}
+
+void Journal::clear() {
+    _changed_nodes.clear();
+    _removed_nodes.clear();
+    _changed_connections.clear();
+    _removed_connections.clear();
+    _renamed_ports.clear();
+}
+
+string Journal::take() {
+    Json::FastWriter writer;
+    stringstream ss;
+
+    // the order matters: connections refer to the nodes (and ports) created
+    // or modified before them, and the removed connections go before the
+    // added ones (a connection removed and drawn again between the same
+    // ports gets a new UUID)
+    for (const auto& kv : _removed_connections) {
+        auto jop = operation("remove_connection", kv.second);
+        jop["uuid"] = uuid_str(kv.first);
+        ss << writer.write(jop);
+    }
+
+    for (const auto& r : _renamed_ports) {
+        auto jop = operation("rename_port", get<0>(r));
+        jop["node"] = uuid_str(get<1>(r));
+        jop["from"] = get<2>(r);
+        jop["to"] = get<3>(r);
+        ss << writer.write(jop);
+    }
+
+    for (const auto& kv : _changed_nodes) {
+        auto node = kv.second.second.lock();
+        if (!node) continue;
+
+        auto jop = operation("node", kv.second.first);
+        jop["node"] = to_json(node);
+        ss << writer.write(jop);
+    }
+
+    for (const auto& kv : _changed_connections) {
+        auto connection = kv.second.second.lock();
+        if (!connection || connection->from.node.expired() ||
+            connection->to.node.expired()) {
+            continue;
+        }
+
+        auto jop = operation("connection", kv.second.first);
+        jop["connection"] = to_json(connection);
+        ss << writer.write(jop);
+    }
+
+    for (const auto& kv : _removed_nodes) {
+        auto jop = operation("remove_node", kv.second);
+        jop["uuid"] = uuid_str(kv.first);
+        ss << writer.write(jop);
+    }
+
+    clear();
+
+    return ss.str();
+}
+
+size_t Journal::replay(Architecture& root, istream& journal) {
+    vector<Json::Value> operations;
+
+    Json::Reader reader;
+    string line;
+    while (getline(journal, line)) {
+        Json::Value jop;
+        // the last line might be truncated if we crashed while writing it
+        if (line.empty() || !reader.parse(line, jop)) continue;
+        operations.push_back(jop);
+    }
+
+    map<boost::uuids::uuid, Architecture*> architectures;
+    collect(root, architectures);
+
+    // operations on a sub-architecture created by a later operation (ie, the
+    // node owning the sub-architecture was journaled after the content of
+    // the sub-architecture) are retried until no more progress is made
+    size_t applied = 0;
+    while (!operations.empty()) {
+        vector<Json::Value> pending;
+        for (const auto& jop : operations) {
+            if (apply(jop, architectures)) {
+                applied++;
+            } else {
+                pending.push_back(jop);
+            }
+        }
+
+        if (pending.size() == operations.size()) {
+            cerr << "Journal: skipping " << pending.size()
+                 << " operations on unknown architectures" << endl;
+            break;
+        }
+        operations.swap(pending);
+    }
+
+    return applied;
+}
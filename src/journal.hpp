@@ -0,0 +1,72 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <boost/uuid/uuid.hpp>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "architecture.hpp"
+#include "connection.hpp"
+#include "node.hpp"
+
+/**
+ * Records the changes made to an architecture (and its sub-architectures)
+ * since the last checkpoint, so that they can be appended to a journal file
+ * instead of re-writing the whole model.
+ *
+ * Changes are coalesced: only the latest state of each modified node or
+ * connection is recorded, whatever the number of times it was modified.
+ * The state itself is only read when the changes are serialized (take()).
+ */
+class Journal {
+   public:
+    void nodeChanged(const Architecture& architecture, ConstNodePtr node);
+    void nodeRemoved(const Architecture& architecture, ConstNodePtr node);
+    void portRenamed(const Architecture& architecture, ConstNodePtr node,
+                     const std::string& from, const std::string& to);
+    void connectionChanged(const Architecture& architecture,
+                           ConstConnectionPtr connection);
+    void connectionRemoved(const Architecture& architecture,
+                           ConstConnectionPtr connection);
+
+    bool empty() const;
+    void clear();
+
+    /**
+     * Serializes the pending changes (one JSON object per line, ready to be
+     * appended to the journal file), and clears them.
+     */
+    std::string take();
+
+    /**
+     * Applies a journal, as written by take(), to an architecture. Returns
+     * the number of operations that were applied.
+     */
+    static size_t replay(Architecture& root, std::istream& journal);
+
+   private:
+    typedef std::pair<boost::uuids::uuid, std::weak_ptr<const Node>>
+        NodeChange;
+    typedef std::pair<boost::uuids::uuid, std::weak_ptr<const Connection>>
+        ConnectionChange;
+
+    // architecture, node, old name, new name
+    typedef std::tuple<boost::uuids::uuid, boost::uuids::uuid, std::string,
+                       std::string>
+        PortRenaming;
+
+    // indexed by the UUID of the node/connection
+    std::map<boost::uuids::uuid, NodeChange> _changed_nodes;
+    std::map<boost::uuids::uuid, boost::uuids::uuid> _removed_nodes;
+    std::map<boost::uuids::uuid, ConnectionChange> _changed_connections;
+    std::map<boost::uuids::uuid, boost::uuids::uuid> _removed_connections;
+
+    // port renamings are replayed in order, before any other change
+    std::vector<PortRenaming> _renamed_ports;
+};
+
+#endif  // JOURNAL_HPP
@@ -53,7 +53,7 @@ void JsonVisitor::onNode(shared_ptr<const Node> node) {
 
     for (const auto port : node->ports()) {
         Json::Value jport;
-        jport["name"] = port->name;
+        jport["name"] = port->name.str();
         jport["direction"] =
             (port->direction == Port::Direction::IN ? "in" : "out");
         jnode["ports"].append(jport);
@@ -64,13 +64,13 @@ void JsonVisitor::onNode(shared_ptr<const Node> node) {
 void JsonVisitor::onConnection(shared_ptr<const Connection> connection) {
     Json::Value jconn;
     jconn["uuid"] = boost::lexical_cast<std::string>(connection->uuid);
-    jconn["name"] = connection->name;
+    jconn["name"] = connection->name.str();
     jconn["from"] =
         boost::lexical_cast<std::string>(connection->from.node.lock()->uuid) +
-        ":" + connection->from.port.lock()->name;
+        ":" + connection->from.port.lock()->name.str();
     jconn["to"] =
         boost::lexical_cast<std::string>(connection->to.node.lock()->uuid) +
-        ":" + connection->to.port.lock()->name;
+        ":" + connection->to.port.lock()->name.str();
 
     arch["connections"].append(jconn);
 }
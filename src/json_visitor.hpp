@@ -17,6 +17,7 @@ class JsonVisitor : public Visitor {
     void onNode(std::shared_ptr<const Node>) override;
     void onConnection(std::shared_ptr<const Connection>) override;
     void tearDown() override;
+    size_t context_size() const override { return approximate_size(root); }
 
     Json::Value getJson() const { return root; }
 
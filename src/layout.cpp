@@ -0,0 +1,558 @@
+#include "layout.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "graph.hpp"
+
+using namespace std;
+
+namespace {
+
+typedef uint32_t Index;
+
+struct Size {
+  double width, height;
+};
+
+// a connected part of an architecture, laid out on its own
+struct Component {
+  // positions of the nodes in the architecture, in topological order
+  vector<Index> nodes;
+  // between positions in 'nodes', from the first to the last
+  vector<pair<Index, Index>> edges;
+
+  // the layout: positions of the nodes (top-left corners), and size of the
+  // whole component
+  vector<double> x, y;
+  double width, height;
+};
+
+// the layout of one architecture
+struct Plan {
+  Architecture *architecture;
+  vector<NodePtr> nodes;
+  vector<Size> sizes;
+  vector<Component> components;
+};
+
+// adjacency arrays: the neighbours of v are targets[offsets[v]] to
+// targets[offsets[v + 1] - 1]
+struct Adjacency {
+  vector<Index> offsets;
+  vector<Index> targets;
+
+  Adjacency(size_t n, const vector<pair<Index, Index>> &edges) {
+    offsets.assign(n + 1, 0);
+    for (const auto &e : edges) {
+      offsets[e.first + 1]++;
+    }
+    for (size_t i = 0; i < n; i++) {
+      offsets[i + 1] += offsets[i];
+    }
+    targets.resize(edges.size());
+    auto next = offsets;
+    for (const auto &e : edges) {
+      targets[next[e.first]++] = e.second;
+    }
+  }
+
+  Index degree(Index v) const { return offsets[v + 1] - offsets[v]; }
+};
+
+vector<pair<Index, Index>> reversed(const vector<pair<Index, Index>> &edges) {
+  vector<pair<Index, Index>> result;
+  result.reserve(edges.size());
+  for (const auto &e : edges) {
+    result.push_back({e.second, e.first});
+  }
+  return result;
+}
+
+// runs f(0) to f(n - 1) on all the cores
+void parallel_for(size_t n, const function<void(size_t)> &f) {
+  size_t workers = min<size_t>(n, max(1u, thread::hardware_concurrency()));
+
+  atomic<size_t> next(0);
+  auto work = [&]() {
+    for (auto i = next++; i < n; i = next++) {
+      f(i);
+    }
+  };
+
+  vector<thread> threads;
+  for (size_t i = 1; i < workers; i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+Size size_of(const Node &node) {
+  if (node.width() > 0 && node.height() > 0) {
+    return {node.width(), node.height()};
+  }
+
+  auto longest = node.name().size();
+  for (const auto &port : node.ports()) {
+    longest = max(longest, port->name.str().size());
+  }
+  return {max(LAYOUT_MIN_WIDTH, LAYOUT_CHAR_WIDTH * (longest + 4)),
+          max(LAYOUT_MIN_HEIGHT,
+              LAYOUT_PORT_HEIGHT * (node.ports().size() + 2))};
+}
+
+// orders the nodes of a cycle so that few connections go backwards (Eades,
+// Lin and Smyth's heuristic): repeatedly takes out the nodes without
+// outputs left (placed last), or else without inputs left (placed first),
+// or else the node with the most outputs relative to its inputs (first)
+vector<Index> feedback_order(const vector<Index> &members,
+                             const Adjacency &successors,
+                             const Adjacency &predecessors,
+                             vector<bool> &in_cycle) {
+  for (auto v : members) {
+    in_cycle[v] = true;
+  }
+
+  // degrees within the cycle, and nodes ranked by outputs - inputs (ties:
+  // the first in the architecture first)
+  unordered_map<Index, long> inputs, outputs;
+  for (auto v : members) {
+    for (auto i = successors.offsets[v]; i < successors.offsets[v + 1]; i++) {
+      if (in_cycle[successors.targets[i]]) {
+        outputs[v]++;
+        inputs[successors.targets[i]]++;
+      }
+    }
+  }
+  priority_queue<pair<long, long>> candidates;
+  for (auto v : members) {
+    candidates.push({outputs[v] - inputs[v], -long(v)});
+  }
+
+  vector<Index> first, last, sources, sinks;
+  auto take = [&](Index v, vector<Index> &order) {
+    in_cycle[v] = false;
+    order.push_back(v);
+    for (auto i = successors.offsets[v]; i < successors.offsets[v + 1]; i++) {
+      auto w = successors.targets[i];
+      if (in_cycle[w]) {
+        if (--inputs[w] == 0) {
+          sources.push_back(w);
+        }
+        candidates.push({outputs[w] - inputs[w], -long(w)});
+      }
+    }
+    for (auto i = predecessors.offsets[v]; i < predecessors.offsets[v + 1];
+         i++) {
+      auto u = predecessors.targets[i];
+      if (in_cycle[u]) {
+        if (--outputs[u] == 0) {
+          sinks.push_back(u);
+        }
+        candidates.push({outputs[u] - inputs[u], -long(u)});
+      }
+    }
+  };
+
+  for (auto left = members.size(); left > 0;) {
+    if (!sinks.empty()) {
+      auto v = sinks.back();
+      sinks.pop_back();
+      if (in_cycle[v]) {
+        take(v, last);
+        left--;
+      }
+    } else if (!sources.empty()) {
+      auto v = sources.back();
+      sources.pop_back();
+      if (in_cycle[v]) {
+        take(v, first);
+        left--;
+      }
+    } else {
+      // the ranks of the nodes change as their neighbours are taken out:
+      // skip the outdated entries
+      auto candidate = candidates.top();
+      candidates.pop();
+      Index v = -candidate.second;
+      if (in_cycle[v] && candidate.first == outputs[v] - inputs[v]) {
+        take(v, first);
+        left--;
+      }
+    }
+  }
+
+  first.insert(first.end(), last.rbegin(), last.rend());
+  return first;
+}
+
+// splits the architecture into its connected parts
+Plan split(Architecture &architecture) {
+  Plan plan{&architecture, {}, {}, {}};
+
+  unordered_map<const Node *, Index> indices;
+  for (const auto &node : architecture.nodes()) {
+    indices[node.get()] = plan.nodes.size();
+    plan.nodes.push_back(node);
+    plan.sizes.push_back(size_of(*node));
+  }
+  auto n = plan.nodes.size();
+
+  vector<pair<Index, Index>> edges;
+  for (const auto &connection : architecture.connections()) {
+    auto from = indices.find(connection->from.node.lock().get());
+    auto to = indices.find(connection->to.node.lock().get());
+    if (from != indices.end() && to != indices.end() &&
+        from->second != to->second) {
+      edges.push_back({from->second, to->second});
+    }
+  }
+
+  // the connections are oriented along the topological order of the
+  // cycles (strongly connected components), and inside the cycles along
+  // feedback_order: only (some of) the connections closing cycles are
+  // reversed
+  Adjacency successors(n, edges);
+  Adjacency predecessors(n, reversed(edges));
+  vector<Index> rank(n);
+  vector<bool> in_cycle(n, false);
+  Index r = 0;
+
+  Graph graph(architecture);
+  for (const auto &component : graph.stronglyConnectedComponents()) {
+    vector<Index> members;
+    for (const auto &node : component) {
+      members.push_back(indices[node.get()]);
+    }
+    if (members.size() > 1) {
+      members = feedback_order(members, successors, predecessors, in_cycle);
+    }
+    for (auto v : members) {
+      rank[v] = r++;
+    }
+  }
+
+  for (auto &e : edges) {
+    if (rank[e.first] > rank[e.second]) {
+      swap(e.first, e.second);
+    }
+  }
+
+  // connected parts (union-find)
+  vector<Index> parent(n);
+  for (Index i = 0; i < n; i++) {
+    parent[i] = i;
+  }
+  auto root = [&](Index i) {
+    while (parent[i] != i) {
+      i = parent[i] = parent[parent[i]];
+    }
+    return i;
+  };
+  for (const auto &e : edges) {
+    parent[root(e.first)] = root(e.second);
+  }
+
+  vector<Index> by_rank(n);
+  for (Index i = 0; i < n; i++) {
+    by_rank[rank[i]] = i;
+  }
+
+  // nodes of each part, in topological order
+  unordered_map<Index, Index> components;
+  vector<Index> local(n);
+  for (auto i : by_rank) {
+    auto c = components.emplace(root(i), plan.components.size());
+    if (c.second) {
+      plan.components.emplace_back();
+    }
+    auto &component = plan.components[c.first->second];
+    local[i] = component.nodes.size();
+    component.nodes.push_back(i);
+  }
+  for (const auto &e : edges) {
+    plan.components[components[root(e.first)]].edges.push_back(
+        {local[e.first], local[e.second]});
+  }
+  return plan;
+}
+
+// places 'layer' in order, each vertex as close to its desired position as
+// possible: the average of the placements packed from the top and from the
+// bottom (both respecting the spacing between the vertices)
+void place(const vector<Index> &layer, const vector<double> &desired,
+           const vector<double> &extent, vector<double> &center) {
+  auto m = layer.size();
+  vector<double> down(m), up(m);
+
+  for (size_t k = 0; k < m; k++) {
+    auto v = layer[k];
+    down[k] = desired[v];
+    if (k > 0) {
+      down[k] = max(down[k], down[k - 1] + extent[layer[k - 1]] + extent[v]);
+    }
+  }
+  for (size_t k = m; k-- > 0;) {
+    auto v = layer[k];
+    up[k] = desired[v];
+    if (k + 1 < m) {
+      up[k] = min(up[k], up[k + 1] - extent[layer[k + 1]] - extent[v]);
+    }
+  }
+  for (size_t k = 0; k < m; k++) {
+    center[layer[k]] = (down[k] + up[k]) / 2;
+  }
+}
+
+void layout(Component &component, const vector<Size> &sizes) {
+  auto n = component.nodes.size();
+  Adjacency predecessors(n, reversed(component.edges));
+  Adjacency successors(n, component.edges);
+
+  // layers: after all the inputs, and the sources just before their first
+  // output
+  vector<Index> layer(n, 0);
+  for (Index v = 0; v < n; v++) {
+    for (auto i = predecessors.offsets[v]; i < predecessors.offsets[v + 1];
+         i++) {
+      layer[v] = max(layer[v], layer[predecessors.targets[i]] + 1);
+    }
+  }
+  for (Index v = n; v-- > 0;) {
+    if (predecessors.degree(v) > 0 || successors.degree(v) == 0) {
+      continue;
+    }
+    auto first = numeric_limits<Index>::max();
+    for (auto i = successors.offsets[v]; i < successors.offsets[v + 1]; i++) {
+      first = min(first, layer[successors.targets[i]]);
+    }
+    layer[v] = first - 1;
+  }
+
+  // virtual nodes along the connections spanning several layers: the
+  // vertices are the nodes, and then the virtual nodes
+  vector<Index> vertex_layer(layer);
+  vector<pair<Index, Index>> segments;
+  for (const auto &e : component.edges) {
+    auto previous = e.first;
+    if (layer[e.second] - layer[e.first] > LAYOUT_MAX_SPAN) {
+      segments.push_back(e);
+      continue;
+    }
+    for (auto l = layer[e.first] + 1; l < layer[e.second]; l++) {
+      Index virtual_node = vertex_layer.size();
+      vertex_layer.push_back(l);
+      segments.push_back({previous, virtual_node});
+      previous = virtual_node;
+    }
+    segments.push_back({previous, e.second});
+  }
+  auto vertices = vertex_layer.size();
+  Adjacency up(vertices, reversed(segments));
+  Adjacency down(vertices, segments);
+
+  vector<vector<Index>> layers(
+      *max_element(vertex_layer.begin(), vertex_layer.end()) + 1);
+  for (Index v = 0; v < vertices; v++) {
+    layers[vertex_layer[v]].push_back(v);
+  }
+
+  // ordering: each vertex at the average position of its neighbours in the
+  // previous layers (resp. the next ones, going up)
+  vector<double> position(vertices), key(vertices);
+  for (const auto &l : layers) {
+    for (size_t k = 0; k < l.size(); k++) {
+      position[l[k]] = k;
+    }
+  }
+
+  auto average = [](const Adjacency &neighbours, Index v,
+                    const vector<double> &values, double otherwise) {
+    if (neighbours.degree(v) == 0) {
+      return otherwise;
+    }
+    double sum = 0;
+    for (auto i = neighbours.offsets[v]; i < neighbours.offsets[v + 1]; i++) {
+      sum += values[neighbours.targets[i]];
+    }
+    return sum / neighbours.degree(v);
+  };
+
+  auto order = [&](vector<Index> &l, const Adjacency &neighbours) {
+    for (auto v : l) {
+      key[v] = average(neighbours, v, position, position[v]);
+    }
+    stable_sort(l.begin(), l.end(),
+                [&](Index a, Index b) { return key[a] < key[b]; });
+    for (size_t k = 0; k < l.size(); k++) {
+      position[l[k]] = k;
+    }
+  };
+
+  for (int sweep = 0; sweep < LAYOUT_ORDERING_SWEEPS; sweep++) {
+    for (size_t l = 1; l < layers.size(); l++) {
+      order(layers[l], up);
+    }
+    for (size_t l = layers.size() - 1; l-- > 0;) {
+      order(layers[l], down);
+    }
+  }
+
+  // placement: 'extent' is the half-height of the vertices, spacing
+  // included (virtual nodes take little room)
+  vector<double> extent(vertices, LAYOUT_NODE_SPACING / 8);
+  for (Index v = 0; v < n; v++) {
+    extent[v] = (sizes[component.nodes[v]].height + LAYOUT_NODE_SPACING) / 2;
+  }
+
+  vector<double> center(vertices, 0), desired(vertices, 0);
+  for (const auto &l : layers) {
+    place(l, desired, extent, center);
+  }
+
+  for (int sweep = 0; sweep < LAYOUT_PLACEMENT_SWEEPS; sweep++) {
+    for (size_t l = 1; l < layers.size(); l++) {
+      for (auto v : layers[l]) {
+        desired[v] = average(up, v, center, center[v]);
+      }
+      place(layers[l], desired, extent, center);
+    }
+    for (size_t l = layers.size() - 1; l-- > 0;) {
+      for (auto v : layers[l]) {
+        desired[v] = average(down, v, center, center[v]);
+      }
+      place(layers[l], desired, extent, center);
+    }
+  }
+
+  // columns, as wide as their widest node
+  vector<double> column_width(layers.size(), 0);
+  for (Index v = 0; v < n; v++) {
+    auto &width = column_width[layer[v]];
+    width = max(width, sizes[component.nodes[v]].width);
+  }
+  vector<double> column_x(layers.size(), 0);
+  for (size_t l = 1; l < layers.size(); l++) {
+    column_x[l] = column_x[l - 1] + column_width[l - 1] + LAYOUT_LAYER_SPACING;
+  }
+
+  component.x.resize(n);
+  component.y.resize(n);
+  double top = numeric_limits<double>::max();
+  for (Index v = 0; v < n; v++) {
+    const auto &size = sizes[component.nodes[v]];
+    component.x[v] =
+        column_x[layer[v]] + (column_width[layer[v]] - size.width) / 2;
+    component.y[v] = center[v] - size.height / 2;
+    top = min(top, component.y[v]);
+  }
+
+  component.width = column_x.back() + column_width.back();
+  component.height = 0;
+  for (Index v = 0; v < n; v++) {
+    component.y[v] -= top;
+    component.height = max(component.height,
+                           component.y[v] + sizes[component.nodes[v]].height);
+  }
+}
+
+// packs the components in rows (the tallest first), about as wide as the
+// whole is tall, and writes the layout back to the nodes
+void apply(Plan &plan) {
+  if (plan.components.empty()) {
+    return;
+  }
+
+  vector<Component *> components;
+  double area = 0, widest = 0;
+  for (auto &component : plan.components) {
+    components.push_back(&component);
+    area += (component.width + LAYOUT_COMPONENT_SPACING) *
+            (component.height + LAYOUT_COMPONENT_SPACING);
+    widest = max(widest, component.width);
+  }
+  stable_sort(components.begin(), components.end(),
+              [](const Component *a, const Component *b) {
+                return a->height > b->height;
+              });
+
+  auto row_width = max(widest, sqrt(area));
+  double x = 0, y = 0, row_height = 0;
+
+  for (auto component : components) {
+    if (x > 0 && x + component->width > row_width) {
+      x = 0;
+      y += row_height + LAYOUT_COMPONENT_SPACING;
+      row_height = 0;
+    }
+
+    for (size_t v = 0; v < component->nodes.size(); v++) {
+      auto i = component->nodes[v];
+      auto &node = plan.nodes[i];
+      node->x(x + component->x[v]);
+      node->y(y + component->y[v]);
+      node->width(plan.sizes[i].width);
+      node->height(plan.sizes[i].height);
+    }
+
+    x += component->width + LAYOUT_COMPONENT_SPACING;
+    row_height = max(row_height, component->height);
+  }
+}
+
+void collect(Architecture &architecture, vector<Architecture *> &result,
+             set<Architecture *> &seen) {
+  if (!seen.insert(&architecture).second) {
+    return;
+  }
+  result.push_back(&architecture);
+  for (const auto &node : architecture.nodes()) {
+    if (node->sub_architecture) {
+      collect(*node->sub_architecture, result, seen);
+    }
+  }
+}
+
+} // namespace
+
+void auto_layout(Architecture &architecture, bool recursive) {
+  vector<Architecture *> architectures{&architecture};
+  if (recursive) {
+    architectures.clear();
+    set<Architecture *> seen;
+    collect(architecture, architectures, seen);
+  }
+
+  vector<Plan> plans(architectures.size());
+  parallel_for(plans.size(),
+               [&](size_t i) { plans[i] = split(*architectures[i]); });
+
+  // the largest components first, not to end up waiting for one of them
+  vector<pair<Component *, const vector<Size> *>> components;
+  for (auto &p : plans) {
+    for (auto &component : p.components) {
+      components.push_back({&component, &p.sizes});
+    }
+  }
+  stable_sort(components.begin(), components.end(),
+              [](const pair<Component *, const vector<Size> *> &a,
+                 const pair<Component *, const vector<Size> *> &b) {
+                return a.first->nodes.size() + a.first->edges.size() >
+                       b.first->nodes.size() + b.first->edges.size();
+              });
+  parallel_for(components.size(), [&](size_t i) {
+    layout(*components[i].first, *components[i].second);
+  });
+
+  parallel_for(plans.size(), [&](size_t i) { apply(plans[i]); });
+}
@@ -0,0 +1,56 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include "architecture.hpp"
+
+// horizontal space between two layers of nodes
+const double LAYOUT_LAYER_SPACING = 120;
+// vertical space between two nodes of a layer
+const double LAYOUT_NODE_SPACING = 40;
+// space between two unconnected parts of an architecture
+const double LAYOUT_COMPONENT_SPACING = 200;
+
+// number of passes (down, then up the layers) ordering the nodes of each
+// layer, and then placing them
+const int LAYOUT_ORDERING_SWEEPS = 12;
+const int LAYOUT_PLACEMENT_SWEEPS = 4;
+
+// connections spanning more layers than this are not routed through virtual
+// nodes (they would be most of the nodes to order and place, for a small
+// improvement of the layout)
+const unsigned LAYOUT_MAX_SPAN = 10;
+
+// size given to the nodes that have none, from their number of ports and
+// their longest name (port or node)
+const double LAYOUT_MIN_WIDTH = 160;
+const double LAYOUT_MIN_HEIGHT = 120;
+const double LAYOUT_CHAR_WIDTH = 7;
+const double LAYOUT_PORT_HEIGHT = 25;
+
+/**
+ * Automatic layered (Sugiyama-style) layout of the nodes of an
+ * architecture, flowing from left to right along the connections, eg for
+ * models generated without positions.
+ *
+ * - the connections closing cycles are reversed (the cycles are ordered as
+ *   in Graph::stronglyConnectedComponents, and the nodes of a cycle with
+ *   Eades, Lin and Smyth's heuristic, to reverse few connections);
+ * - each node is assigned a layer (a column), after all its inputs;
+ *   connections spanning several layers (up to LAYOUT_MAX_SPAN) go through
+ *   virtual nodes;
+ * - the nodes of each layer are ordered by the average position of their
+ *   neighbours in the previous (resp. next) layers, to reduce crossings;
+ * - and placed as close to their neighbours as the spacing allows.
+ *
+ * The unconnected parts of the architecture are laid out separately, and
+ * then packed in rows. The positions, and the sizes of the nodes without
+ * any, are written back to the nodes: existing positions are overwritten.
+ *
+ * With 'recursive', the sub-architectures are laid out as well (each on its
+ * own). The connected parts of all the architectures are laid out in
+ * parallel, on all the cores. Runs in time linear in the number of nodes and
+ * connections, and of virtual nodes (about 10k nodes in less than a second).
+ */
+void auto_layout(Architecture &architecture, bool recursive = true);
+
+#endif // LAYOUT_HPP
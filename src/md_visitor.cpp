@@ -5,7 +5,6 @@
 
 #include <curl/curl.h>
 
-#include <QStandardPaths>
 #include <algorithm>
 #include <filesystem>
 #include <memory>
@@ -16,6 +15,8 @@
 #include "inja/inja.hpp"
 #include "label.hpp"
 #include "node.hpp"
+#include "templates.hpp"
+#include "trace.hpp"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -32,35 +33,13 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
 
 MdVisitor::MdVisitor(const Architecture &architecture, const string &ws_path)
     : Visitor(architecture), ws_path(ws_path) {
-  fs::path tpl_path;
+  env_ = make_unique<inja::Environment>(
+      "", ws_path + fs::path::preferred_separator);
 
-  for (auto p :
-       QStandardPaths::standardLocations(QStandardPaths::AppDataLocation)) {
-    tpl_path = fs::path(p.toStdString()) / "templates" / "md";
-    cout << "Looking for MD templates in " << tpl_path << endl;
-
-    if (fs::exists(tpl_path)) {
-      break;
-    }
-    tpl_path = "";
-  }
-
-  if (!tpl_path.empty()) {
-    cout << "Using Markdown templates found at " << tpl_path << endl;
-    env_ = make_unique<inja::Environment>(
-        tpl_path.string() + fs::path::preferred_separator,
-        ws_path + fs::path::preferred_separator);
-
-    env_->set_line_statement("$$$$$");
-    env_->set_comment("{##", "##}"); // Comments
-    env_->set_trim_blocks(true);
-    env_->set_lstrip_blocks(true);
-
-  } else {
-    cout << "[EE] Markdown templates not found! Can not generate Markdown "
-            "output."
-         << endl;
-  }
+  env_->set_line_statement("$$$$$");
+  env_->set_comment("{##", "##}"); // Comments
+  env_->set_trim_blocks(true);
+  env_->set_lstrip_blocks(true);
 }
 
 void MdVisitor::startUp() {
@@ -77,9 +56,6 @@ void MdVisitor::startUp() {
 }
 
 void MdVisitor::tearDown() {
-  if (!env_)
-    return;
-
   std::sort(data_["nodes"].begin(), data_["nodes"].end(),
             [](const nlohmann::json &n1, const nlohmann::json &n2) -> bool {
               return n1["id"] < n2["id"];
@@ -90,14 +66,17 @@ void MdVisitor::tearDown() {
   auto id = make_id(architecture.name);
 
   for (const auto &file : tpls) {
-    cout << "Generating " << file << "..." << endl;
-    auto tpl = env_->parse_template(file);
+    export_log() << "Generating " << file << "...";
+    auto tpl = traced("parse_template", "template", [&]() {
+      return env_->parse(load_template("md/" + file));
+    });
+    TraceScope trace("write", "template");
     env_->write(tpl, data_, file);
   }
 
-  cout << "Generation of Markdown complete. The generated files can be "
-          "found in "
-       << ws_path << endl;
+  export_log() << "Generation of Markdown complete. The generated files "
+                  "can be found in "
+               << ws_path;
 }
 
 void MdVisitor::beginNodes() {}
@@ -126,10 +105,9 @@ void MdVisitor::onNode(shared_ptr<const Node> node) {
     if (!node->sub_architecture ||
         node->sub_architecture->description.size() == 0) {
       jnode["generate"] = true;
-      cout << "ATTENTION! Node " << name
-           << " is not marked for mocking-up ('MOCK'), but no repo is "
-              "provided. Mocking it up anyway."
-           << endl;
+      export_log() << "ATTENTION! Node " << name
+                   << " is not marked for mocking-up ('MOCK'), but no repo is "
+                      "provided. Mocking it up anyway.";
     } else {
       jnode["generate"] = false;
 
@@ -148,6 +126,8 @@ void MdVisitor::onNode(shared_ptr<const Node> node) {
           curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
           curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
           curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+          TraceScope trace("FETCH_DOC", "network");
+          trace.arg("url", url);
           res = curl_easy_perform(curl);
           jnode["description"] = readBuffer;
           continue;
@@ -202,7 +182,7 @@ void MdVisitor::onNode(shared_ptr<const Node> node) {
 
     bool isInput = (p->direction == Port::Direction::IN);
 
-    auto name = p->name;
+    auto name = p->name.str();
     jport["name"] = name;
 
     regex topic_regex("^(/.*) \\[(.*)\\]$", regex_constants::ECMAScript);
@@ -221,10 +201,11 @@ void MdVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "subscribes to" : "publishes") << " topic "
-           << jport["topic"] << " (short: " << jport["short"] << ") of type "
-           << jport["type"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "subscribes to" : "publishes") << " topic "
+                   << jport["topic"] << " (short: " << jport["short"]
+                   << ") of type "
+                   << jport["type"];
 
     } else if (regex_search(name, tf_matches, tf_regex)) {
       jport["type"] = "tf";
@@ -239,9 +220,9 @@ void MdVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "listen to" : "broadcasts") << " TF frame "
-           << jport["frame"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "listen to" : "broadcasts") << " TF frame "
+                   << jport["frame"];
     } else {
       jport["type"] = "undefined";
       auto id = make_id(name);
@@ -0,0 +1,197 @@
+#include "memory_stats.hpp"
+
+#include <array>
+#include <atomic>
+#include <boost/uuid/uuid_io.hpp>
+#include <iomanip>
+#include <sstream>
+
+#include "architecture.hpp"
+
+using namespace std;
+
+namespace {
+
+struct Counter {
+    atomic<size_t> held{0};
+    atomic<size_t> peak{0};
+};
+
+const size_t CATEGORIES = static_cast<size_t>(MemoryCategory::EXPORT) + 1;
+
+array<Counter, CATEGORIES>& counters() {
+    static array<Counter, CATEGORIES> counters;
+    return counters;
+}
+
+Counter& counter(MemoryCategory category) {
+    return counters()[static_cast<size_t>(category)];
+}
+
+void count(const Architecture& architecture, const string& path,
+           Json::Value& architectures, Json::Value& total) {
+    size_t ports = 0, sub_architectures = 0;
+    for (const auto& node : architecture.nodes()) {
+        ports += node->ports().size();
+        if (node->sub_architecture) sub_architectures++;
+    }
+
+    Json::Value stats;
+    stats["path"] = path;
+    stats["name"] = architecture.name;
+    stats["uuid"] = boost::uuids::to_string(architecture.uuid);
+    stats["nodes"] = Json::UInt64(architecture.nodes().size());
+    stats["ports"] = Json::UInt64(ports);
+    stats["connections"] = Json::UInt64(architecture.connections().size());
+    stats["sub_architectures"] = Json::UInt64(sub_architectures);
+
+    total["architectures"] =
+        Json::UInt64(total["architectures"].asUInt64() + 1);
+    for (const auto& key : {"nodes", "ports", "connections"}) {
+        total[key] =
+            Json::UInt64(total[key].asUInt64() + stats[key].asUInt64());
+    }
+    architectures.append(stats);
+
+    for (const auto& node : architecture.nodes()) {
+        if (!node->sub_architecture) continue;
+        count(*node->sub_architecture,
+              path.empty() ? node->name() : path + "/" + node->name(),
+              architectures, total);
+    }
+}
+
+string format_bytes(size_t bytes) {
+    stringstream ss;
+    if (bytes < 1024) {
+        ss << bytes << " B";
+    } else if (bytes < 1024 * 1024) {
+        ss << fixed << setprecision(1) << bytes / 1024. << " kB";
+    } else {
+        ss << fixed << setprecision(1) << bytes / (1024. * 1024.) << " MB";
+    }
+    return ss.str();
+}
+
+}  // namespace
+
+void MemoryStats::allocated(MemoryCategory category, size_t bytes) {
+    auto& c = counter(category);
+    auto held = c.held.fetch_add(bytes, memory_order_relaxed) + bytes;
+
+    auto peak = c.peak.load(memory_order_relaxed);
+    while (held > peak &&
+           !c.peak.compare_exchange_weak(peak, held, memory_order_relaxed)) {
+    }
+}
+
+void MemoryStats::released(MemoryCategory category, size_t bytes) {
+    counter(category).held.fetch_sub(bytes, memory_order_relaxed);
+}
+
+size_t MemoryStats::held(MemoryCategory category) {
+    return counter(category).held.load(memory_order_relaxed);
+}
+
+size_t MemoryStats::peak(MemoryCategory category) {
+    return counter(category).peak.load(memory_order_relaxed);
+}
+
+void MemoryStats::Account::set(size_t bytes) {
+    if (bytes > _bytes) {
+        allocated(_category, bytes - _bytes);
+    } else {
+        released(_category, _bytes - bytes);
+    }
+    _bytes = bytes;
+}
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    auto p = _upstream->allocate(bytes, alignment);
+    MemoryStats::allocated(_category, bytes);
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t bytes,
+                                     size_t alignment) {
+    MemoryStats::released(_category, bytes);
+    _upstream->deallocate(p, bytes, alignment);
+}
+
+bool CountingResource::do_is_equal(
+    const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+size_t approximate_size(const Json::Value& value) {
+    size_t bytes = sizeof(Json::Value);
+
+    switch (value.type()) {
+        case Json::stringValue: {
+            const char *begin, *end;
+            // the length is stored before the characters
+            if (value.getString(&begin, &end)) {
+                bytes += sizeof(unsigned) + (end - begin) + 1;
+            }
+            break;
+        }
+        case Json::arrayValue:
+        case Json::objectValue:
+            // one tree node (3 pointers and the color) per member, keyed
+            // by the index or by a copy of the name
+            bytes += sizeof(void*) * 6;
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                bytes += 4 * sizeof(void*) + 2 * sizeof(void*) +
+                         approximate_size(*it);
+                if (value.isObject()) bytes += it.name().size() + 1;
+            }
+            break;
+        default:
+            break;
+    }
+    return bytes;
+}
+
+Json::Value statistics(const Architecture& architecture) {
+    Json::Value stats;
+    stats["architectures"] = Json::arrayValue;
+    count(architecture, "", stats["architectures"], stats["total"]);
+
+    for (const auto& category : MEMORY_CATEGORY_NAMES) {
+        auto& memory = stats["memory"][category.second];
+        memory["bytes"] = Json::UInt64(MemoryStats::held(category.first));
+        memory["peak"] = Json::UInt64(MemoryStats::peak(category.first));
+    }
+    return stats;
+}
+
+string format_statistics(const Json::Value& stats, bool details) {
+    stringstream ss;
+
+    const auto& total = stats["total"];
+    ss << total["architectures"].asUInt64() << " architecture(s), "
+       << total["nodes"].asUInt64() << " nodes, " << total["ports"].asUInt64()
+       << " ports, " << total["connections"].asUInt64() << " connections\n";
+
+    ss << "\nMemory (approximate):\n";
+    for (const auto& category : MEMORY_CATEGORY_NAMES) {
+        const auto& memory = stats["memory"][category.second];
+        ss << "  " << category.second << ": "
+           << format_bytes(memory["bytes"].asUInt64()) << " (peak "
+           << format_bytes(memory["peak"].asUInt64()) << ")\n";
+    }
+
+    if (!details) return ss.str();
+
+    ss << "\nArchitectures:\n";
+    for (const auto& architecture : stats["architectures"]) {
+        auto path = architecture["path"].asString();
+        ss << "  " << (path.empty() ? "(root)" : path) << ": "
+           << architecture["nodes"].asUInt64() << " nodes, "
+           << architecture["ports"].asUInt64() << " ports, "
+           << architecture["connections"].asUInt64() << " connections, "
+           << architecture["sub_architectures"].asUInt64()
+           << " sub-architecture(s)\n";
+    }
+    return ss.str();
+}
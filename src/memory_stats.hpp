@@ -0,0 +1,197 @@
+#ifndef MEMORY_STATS_HPP
+#define MEMORY_STATS_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+#include "json/json.h"
+
+class Architecture;
+
+enum class MemoryCategory { MODEL, STRINGS, GRAPHICS, EXPORT };
+
+static const std::map<MemoryCategory, std::string> MEMORY_CATEGORY_NAMES{
+    {MemoryCategory::MODEL, "model"},
+    {MemoryCategory::STRINGS, "strings"},
+    {MemoryCategory::GRAPHICS, "graphics"},
+    {MemoryCategory::EXPORT, "export"},
+};
+
+/**
+ * Approximate accounting of the memory held by the main kinds of objects:
+ * - MODEL: the nodes, ports, connections and sub-architectures (the
+ *   objects themselves, or the arena blocks they are allocated in);
+ * - STRINGS: the strings interned in the StringTables;
+ * - GRAPHICS: the GraphicsNode, GraphicsNodeSocket and GraphicsDirectedEdge
+ *   items of the scenes;
+ * - EXPORT: the JSON contexts built by the exporters.
+ *
+ * The memory of the containers inside these objects (eg, the list of ports
+ * of a node), and of the Qt private objects, is not accounted.
+ *
+ * The counters are updated by CountingAllocator and CountingResource, and
+ * can be read from any thread.
+ */
+class MemoryStats {
+   public:
+    static void allocated(MemoryCategory category, size_t bytes);
+    static void released(MemoryCategory category, size_t bytes);
+
+    // bytes currently held
+    static size_t held(MemoryCategory category);
+
+    // highest value of held() since the start of the program
+    static size_t peak(MemoryCategory category);
+
+    /**
+     * Bytes accounted as long as the Account is alive, for objects whose
+     * allocations can not be counted as they happen (eg, the JSON documents
+     * of the exporters): their size is estimated once they are built.
+     */
+    class Account {
+       public:
+        explicit Account(MemoryCategory category) : _category(category) {}
+        ~Account() { set(0); }
+
+        Account(const Account&) = delete;
+        Account& operator=(const Account&) = delete;
+
+        void set(size_t bytes);
+
+       private:
+        MemoryCategory _category;
+        size_t _bytes = 0;
+    };
+};
+
+/**
+ * Memory resource counting the memory obtained from its upstream resource
+ * (eg, the blocks of a monotonic_buffer_resource).
+ */
+class CountingResource : public std::pmr::memory_resource {
+   public:
+    explicit CountingResource(
+        MemoryCategory category,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _category(category), _upstream(upstream) {}
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+
+    MemoryCategory _category;
+    std::pmr::memory_resource* _upstream;
+};
+
+/**
+ * Heap allocator counting its allocations, eg to create counted objects
+ * with std::allocate_shared (see make_counted).
+ */
+template <class T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    explicit CountingAllocator(MemoryCategory category) : category(category) {}
+
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>& other)
+        : category(other.category) {}
+
+    T* allocate(size_t n) {
+        auto p = std::allocator<T>().allocate(n);
+        MemoryStats::allocated(category, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) {
+        MemoryStats::released(category, n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    MemoryCategory category;
+};
+
+template <class T, class U>
+bool operator==(const CountingAllocator<T>& l, const CountingAllocator<U>& r) {
+    return l.category == r.category;
+}
+
+template <class T, class U>
+bool operator!=(const CountingAllocator<T>& l, const CountingAllocator<U>& r) {
+    return !(l == r);
+}
+
+/**
+ * Creates an object on the heap, accounted in the given category.
+ */
+template <class T, class... Args>
+std::shared_ptr<T> make_counted(MemoryCategory category, Args&&... args) {
+    return std::allocate_shared<T>(CountingAllocator<T>(category),
+                                   std::forward<Args>(args)...);
+}
+
+/**
+ * Approximate size of a JSON document (jsoncpp), including its nested values
+ * and strings.
+ */
+size_t approximate_size(const Json::Value& value);
+
+/**
+ * Approximate size of a JSON document (nlohmann::json, as used by the
+ * template-based exporters), including its nested values and strings.
+ */
+template <class BasicJson>
+size_t approximate_json_size(const BasicJson& value) {
+    size_t bytes = sizeof(BasicJson);
+
+    if (value.is_string()) {
+        const auto& str = value.template get_ref<const std::string&>();
+        bytes += sizeof(std::string) + str.capacity();
+    } else if (value.is_object()) {
+        // one tree node (3 pointers and the color) per member
+        for (const auto& item : value.items()) {
+            bytes += 4 * sizeof(void*) + sizeof(std::string) +
+                     item.key().capacity() +
+                     approximate_json_size(item.value());
+        }
+        bytes += sizeof(void*) * 6;
+    } else if (value.is_array()) {
+        for (const auto& item : value) {
+            bytes += approximate_json_size(item);
+        }
+        bytes += sizeof(void*) * 3;
+    }
+    return bytes;
+}
+
+/**
+ * Returns the counts of nodes, ports, connections and sub-architectures of
+ * each architecture of the hierarchy, and the memory currently accounted by
+ * MemoryStats:
+ *
+ * {
+ *   "architectures": [{"path": "perception/face", "name": ..., "uuid": ...,
+ *                      "nodes": N, "ports": N, "connections": N,
+ *                      "sub_architectures": N}, ...],
+ *   "total": {"architectures": N, "nodes": N, ...},
+ *   "memory": {"model": {"bytes": N, "peak": N}, "strings": ..., ...}
+ * }
+ *
+ * The path of an architecture is made of the names of the nodes that own it
+ * and its ancestors ("" for the root architecture).
+ */
+Json::Value statistics(const Architecture& architecture);
+
+/**
+ * Human-readable summary of statistics(): the totals and the memory, and,
+ * if 'details' is true, one line per architecture.
+ */
+std::string format_statistics(const Json::Value& stats, bool details = false);
+
+#endif  // MEMORY_STATS_HPP
@@ -3,6 +3,10 @@
 #include "node.hpp"
 
 #include <QDebug>
+#include <algorithm>
+
+#include "arena.hpp"
+#include "uuid_generator.hpp"
 
 using namespace std;
 
@@ -11,9 +15,9 @@ const map<Port::Type, std::string> Port::TYPENAME{{Type::EXPLICIT, "[->]"},
                                                   {Type::EVENT, "[!]"},
                                                   {Type::OTHER, ""}};
 
-Node::Node() : Node(boost::uuids::random_generator()()) {}
+Node::Node() : Node(make_uuid()) {}
 Node::Node(boost::uuids::uuid uuid)
-    : uuid(uuid), _x(0), _y(0), _label(Label::OTHER) {}
+    : uuid(uuid), _x(0), _y(0), _width(0), _height(0), _label(Label::OTHER) {}
 
 Node::~Node() {
     // qWarning() << "Node " << QString::fromStdString(_name) << " deleted!!";
@@ -22,7 +26,7 @@ Node::~Node() {
 /* Performs a deep-copy of the current Node, with however a new UUID
  */
 NodePtr Node::duplicate() const {
-    auto node = make_shared<Node>();
+    auto node = make_model<Node>();
     node->name(_name + " (copy)");
     node->label(_label);
 
@@ -34,29 +38,55 @@ NodePtr Node::duplicate() const {
 }
 
 PortPtr Node::createPort(const Port port) {
-    auto portPtr = make_shared<Port>(port);
-
     // check that we do not already have this port
-    for (auto p : _ports) {
-        if (p == portPtr) return nullptr;
-    }
+    if (_ports_by_name.count(port.name)) return nullptr;
+
+    auto portPtr = make_model<Port>(port);
 
-    _ports.insert(portPtr);
+    _ports.push_back(portPtr);
+    _ports_by_name[portPtr->name] = portPtr;
     emit dirty();  // signal update
     return portPtr;
 }
 
+bool Node::rename_port(PortPtr port, const Name& name) {
+    if (port->name == name) return true;
+    if (_ports_by_name.count(name)) return false;
+
+    auto it = _ports_by_name.find(port->name);
+    if (it == _ports_by_name.end() || it->second != port) return false;
+
+    _ports_by_name.erase(it);
+    port->name = name;
+    _ports_by_name[name] = port;
+
+    emit dirty();
+    return true;
+}
+
 void Node::remove_port(PortPtr port) {
-    _ports.erase(port);
+    auto it = find(_ports.begin(), _ports.end(), port);
+    if (it == _ports.end()) return;
+
+    _ports.erase(it);
+    _ports_by_name.erase(port->name);
 
     emit dirty();
 }
 
-PortPtr Node::port(const string& name) {
-    for (auto p : _ports) {
-        if (p->name == name) return p;
+PortPtr Node::port(const string& name) const {
+    auto it = _ports_by_name.find(name);
+    if (it == _ports_by_name.end()) return nullptr;
+    return it->second;
+}
+
+string Node::unique_port_name(const string& name) const {
+    if (!_ports_by_name.count(name)) return name;
+
+    for (size_t i = 2;; i++) {
+        auto candidate = name + "_" + to_string(i);
+        if (!_ports_by_name.count(candidate)) return candidate;
     }
-    return nullptr;
 }
 
 void Node::name(const std::string& name) {
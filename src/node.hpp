@@ -3,14 +3,15 @@
 
 #include <QObject>
 #include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "label.hpp"
+#include "string_table.hpp"
 
 class Architecture;
 
@@ -22,14 +23,14 @@ struct Port {
     static const std::map<Type, std::string> TYPENAME;
 
     Port() {}
-    Port(std::string name, Direction direction, Type type)
+    Port(Name name, Direction direction, Type type)
         : name(name), direction(direction), type(type) {}
 
     friend bool operator<(const Port& l, const Port& r) {
         return l.name < r.name;
     }
 
-    std::string name;
+    Name name;
     Direction direction;
     Type type;
 };
@@ -72,11 +73,20 @@ struct Node : public QObject {
     double height() const { return _height; }
     void height(double height) { _height = height; }
 
+    typedef std::vector<PortPtr> Ports;
+
+    // port names are unique within a node: createPort and rename_port refuse
+    // (returning resp. nullptr and false) to create a duplicate
     PortPtr createPort(const Port port);
+    bool rename_port(PortPtr port, const Name& name);
     void remove_port(PortPtr port);
-    PortPtr port(const std::string& name);
+    PortPtr port(const std::string& name) const;
+
+    // returns a name, derived from 'name', that no port of the node uses yet
+    std::string unique_port_name(const std::string& name) const;
 
-    const std::set<PortPtr> ports() const { return _ports; }
+    // the ports, in creation order
+    const Ports& ports() const { return _ports; }
 
     boost::uuids::uuid uuid;
 
@@ -91,7 +101,8 @@ struct Node : public QObject {
 
     std::string _name;
     Label _label;
-    std::set<PortPtr> _ports;
+    Ports _ports;
+    std::map<Name, PortPtr, std::less<>> _ports_by_name;
 };
 
 #endif  // __NODE_HPP
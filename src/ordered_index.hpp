@@ -0,0 +1,166 @@
+#ifndef ORDERED_INDEX_HPP
+#define ORDERED_INDEX_HPP
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Set of model objects (nodes, connections: anything with a 'uuid' member),
+ * held by shared pointers, iterated in insertion order and indexed by UUID.
+ *
+ * Unlike a std::set of pointers, ordered by memory address, the iteration
+ * order does not change from one run to the next: exports, and the ids
+ * generated for them, are reproducible. Loaded models are iterated in the
+ * order of the file.
+ *
+ * Elements are unique by UUID. Removing an element leaves a hole in the
+ * underlying vector (skipped by the iterators), compacted once half of the
+ * vector is made of holes: insertion, removal and lookup are all O(1)
+ * (amortized). Iterators are invalidated by any modification.
+ */
+template <class T> class OrderedIndex {
+public:
+  typedef std::shared_ptr<T> value_type;
+
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef OrderedIndex::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type *pointer;
+    typedef const value_type &reference;
+
+    const_iterator() {}
+
+    reference operator*() const { return *_it; }
+    pointer operator->() const { return &*_it; }
+
+    const_iterator &operator++() {
+      ++_it;
+      skipHoles();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto previous = *this;
+      ++*this;
+      return previous;
+    }
+
+    bool operator==(const const_iterator &other) const {
+      return _it == other._it;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return _it != other._it;
+    }
+
+  private:
+    friend class OrderedIndex;
+    typedef typename std::vector<value_type>::const_iterator Base;
+
+    const_iterator(Base it, Base end) : _it(it), _end(end) { skipHoles(); }
+
+    void skipHoles() {
+      while (_it != _end && !*_it) {
+        ++_it;
+      }
+    }
+
+    Base _it, _end;
+  };
+  typedef const_iterator iterator;
+
+  OrderedIndex() {}
+
+  template <class InputIt> OrderedIndex(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  const_iterator begin() const { return {_elements.begin(), _elements.end()}; }
+  const_iterator end() const { return {_elements.end(), _elements.end()}; }
+
+  size_t size() const { return _positions.size(); }
+  bool empty() const { return _positions.empty(); }
+
+  /**
+   * Appends 'element', unless an element with the same UUID is already
+   * present. Returns the position of the element with this UUID, and
+   * whether 'element' was inserted.
+   */
+  std::pair<const_iterator, bool> insert(const value_type &element) {
+    auto inserted = _positions.emplace(element->uuid, _elements.size());
+    if (inserted.second) {
+      _elements.push_back(element);
+    }
+    return {at(inserted.first->second), inserted.second};
+  }
+
+  size_t erase(const value_type &element) {
+    auto position = _positions.find(element->uuid);
+    if (position == _positions.end() ||
+        _elements[position->second] != element) {
+      return 0;
+    }
+
+    _elements[position->second] = nullptr;
+    _positions.erase(position);
+
+    if (_positions.size() < _elements.size() / 2) {
+      compact();
+    }
+    return 1;
+  }
+
+  size_t count(const value_type &element) const {
+    auto position = _positions.find(element->uuid);
+    return position != _positions.end() &&
+           _elements[position->second] == element;
+  }
+
+  /**
+   * Returns the element with the given UUID, or nullptr.
+   */
+  value_type find(const boost::uuids::uuid &uuid) const {
+    auto position = _positions.find(uuid);
+    if (position == _positions.end()) {
+      return nullptr;
+    }
+    return _elements[position->second];
+  }
+
+  void clear() {
+    _elements.clear();
+    _positions.clear();
+  }
+
+private:
+  const_iterator at(size_t position) const {
+    return {_elements.begin() + position, _elements.end()};
+  }
+
+  void compact() {
+    size_t next = 0;
+    for (auto &element : _elements) {
+      if (element) {
+        _positions[element->uuid] = next;
+        _elements[next++] = std::move(element);
+      }
+    }
+    _elements.resize(next);
+  }
+
+  // in insertion order, with holes (nullptr) where elements were removed
+  std::vector<value_type> _elements;
+  std::unordered_map<boost::uuids::uuid, size_t,
+                     boost::hash<boost::uuids::uuid>>
+      _positions;
+};
+
+#endif // ORDERED_INDEX_HPP
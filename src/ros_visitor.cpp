@@ -3,7 +3,6 @@
 
 #include "ros_visitor.hpp"
 
-#include <QStandardPaths>
 #include <algorithm>
 #include <filesystem>
 #include <memory>
@@ -11,9 +10,12 @@
 #include <regex>
 #include <string>
 
+#include "graph.hpp"
 #include "inja/inja.hpp"
 #include "label.hpp"
 #include "node.hpp"
+#include "templates.hpp"
+#include "trace.hpp"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -91,38 +93,20 @@ tuple<string, string> prepareTopic(string topic_in) {
 
 RosVisitor::RosVisitor(const Architecture &architecture, const string &ws_path)
     : Visitor(architecture), ws_path(ws_path) {
-  fs::path tpl_path;
+  // no input path: the templates are given by load_template
+  env_ = make_unique<inja::Environment>(
+      "", ws_path + fs::path::preferred_separator);
 
-  for (auto p :
-       QStandardPaths::standardLocations(QStandardPaths::AppDataLocation)) {
-    tpl_path = fs::path(p.toStdString()) / "templates" / "ros";
-    cout << "Looking for ROS templates in " << tpl_path << endl;
+  env_->set_line_statement("$$$$$");
+  env_->set_trim_blocks(true);
+  env_->set_lstrip_blocks(true);
 
-    if (fs::exists(tpl_path)) {
-      break;
-    }
-  }
-
-  if (!tpl_path.empty()) {
-    cout << "Using ROS templates found at " << tpl_path << endl;
-    env_ = make_unique<inja::Environment>(
-        (tpl_path / "default").string() + fs::path::preferred_separator,
-        ws_path + fs::path::preferred_separator);
-
-    env_->set_line_statement("$$$$$");
-    env_->set_trim_blocks(true);
-    env_->set_lstrip_blocks(true);
+  env_main_node_ = make_unique<inja::Environment>(
+      "", ws_path + fs::path::preferred_separator);
 
-    env_main_node_ = make_unique<inja::Environment>(
-        (tpl_path / "main_node").string() + fs::path::preferred_separator,
-        ws_path + fs::path::preferred_separator);
-
-    env_main_node_->set_line_statement("$$$$$");
-    env_main_node_->set_trim_blocks(true);
-    env_main_node_->set_lstrip_blocks(true);
-  } else {
-    cout << "[EE] ROS templates not found! Can not generate ROS nodes." << endl;
-  }
+  env_main_node_->set_line_statement("$$$$$");
+  env_main_node_->set_trim_blocks(true);
+  env_main_node_->set_lstrip_blocks(true);
 }
 
 void RosVisitor::startUp() {
@@ -135,15 +119,25 @@ void RosVisitor::startUp() {
 }
 
 void RosVisitor::tearDown() {
-  if (!env_)
-    return;
-
   ///////////////////////////////////////////////////////
   // Create parent node with main launchfile
   //
   vector<string> main_node_tpls{"package.xml", "CMakeLists.txt",
                                 "launch/start_all.launch"};
 
+  // the main launch file starts the nodes in dependency order
+  map<string, size_t> ranks;
+  size_t rank = 0;
+  for (const auto &id : get_ids(Graph(architecture).topologicalOrder())) {
+    ranks[id] = rank++;
+  }
+  std::stable_sort(data_["nodes"].begin(), data_["nodes"].end(),
+                   [&ranks](const nlohmann::json &n1,
+                            const nlohmann::json &n2) -> bool {
+                     return ranks[n1["id"].get<string>()] <
+                            ranks[n2["id"].get<string>()];
+                   });
+
   auto id = make_id(architecture.name);
   auto rel_path = fs::path("src") / id;
   auto abs_path = fs::path(ws_path) / rel_path;
@@ -151,7 +145,10 @@ void RosVisitor::tearDown() {
   fs::create_directories(launch_path); // will also create 'path'
 
   for (const auto &file : main_node_tpls) {
-    auto tpl = env_main_node_->parse_template(file);
+    auto tpl = traced("parse_template", "template", [&]() {
+      return env_main_node_->parse(load_template("ros/main_node/" + file));
+    });
+    TraceScope trace("write", "template");
     env_main_node_->write(tpl, data_, (rel_path / file).string());
   }
 
@@ -160,26 +157,35 @@ void RosVisitor::tearDown() {
   //
   vector<string> default_tpls{"package.xml", "CMakeLists.txt", "src/main.cpp"};
 
+  // parsed once for all the nodes
+  vector<inja::Template> parsed_tpls;
+  for (const auto &file : default_tpls) {
+    parsed_tpls.push_back(traced("parse_template", "template", [&]() {
+      return env_->parse(load_template("ros/default/" + file));
+    }));
+  }
+
   for (auto node : data_["nodes"]) {
     string id(node["id"]);
-    cout << "Generating " << node["name"] << " as node [" << id << "]..."
-         << endl;
+    export_log() << "Generating " << node["name"] << " as node [" << id
+                 << "]...";
 
     auto rel_path = fs::path("src") / id;
     auto abs_path = fs::path(ws_path) / rel_path;
     auto src_path = abs_path / "src";
     fs::create_directories(src_path); // will also create 'path'
 
-    for (const auto &file : default_tpls) {
-      auto tpl = env_->parse_template(file);
-      // cout << "\t- " << (abs_path / file).string() << endl;
-      env_->write(tpl, node, (rel_path / file).string());
+    for (size_t idx = 0; idx < default_tpls.size(); idx++) {
+      // cout << "\t- " << (abs_path / default_tpls[idx]).string() << endl;
+      TraceScope trace("write", "template");
+      env_->write(parsed_tpls[idx], node,
+                  (rel_path / default_tpls[idx]).string());
     }
   }
 
-  cout << "Generation of ROS nodes complete. The generated nodes can be "
-          "found in "
-       << ws_path << endl;
+  export_log() << "Generation of ROS nodes complete. The generated nodes "
+                  "can be found in "
+               << ws_path;
 }
 
 void RosVisitor::beginNodes() {}
@@ -202,10 +208,9 @@ void RosVisitor::onNode(shared_ptr<const Node> node) {
     if (!node->sub_architecture ||
         node->sub_architecture->description.size() == 0) {
       jnode["generate"] = true;
-      cout << "ATTENTION! Node " << name
-           << " is not marked for mocking-up ('MOCK'), but no repo is "
-              "provided. Mocking it up anyway."
-           << endl;
+      export_log() << "ATTENTION! Node " << name
+                   << " is not marked for mocking-up ('MOCK'), but no repo is "
+                      "provided. Mocking it up anyway.";
     } else {
       jnode["generate"] = false;
       jnode["repo"] =
@@ -244,7 +249,7 @@ void RosVisitor::onNode(shared_ptr<const Node> node) {
 
     bool isInput = (p->direction == Port::Direction::IN);
 
-    auto name = p->name;
+    auto name = p->name.str();
     jport["name"] = name;
 
     regex topic_regex("^(/.*) \\[(.*)\\]$", regex_constants::ECMAScript);
@@ -263,10 +268,11 @@ void RosVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "subscribes to" : "publishes") << " topic "
-           << jport["topic"] << " (short: " << jport["short"] << ") of type "
-           << jport["type"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "subscribes to" : "publishes") << " topic "
+                   << jport["topic"] << " (short: " << jport["short"]
+                   << ") of type "
+                   << jport["type"];
 
     } else if (regex_search(name, tf_matches, tf_regex)) {
       jport["type"] = "tf";
@@ -281,9 +287,9 @@ void RosVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "listen to" : "broadcasts") << " TF frame "
-           << jport["frame"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "listen to" : "broadcasts") << " TF frame "
+                   << jport["frame"];
     } else {
       jport["type"] = "undefined";
       auto id = make_id(name);
@@ -23,6 +23,9 @@ class RosVisitor : public Visitor {
     void beginConnections() override;
     void onConnection(std::shared_ptr<const Connection>) override;
     void tearDown() override;
+    size_t context_size() const override {
+        return approximate_json_size(data_);
+    }
 
    private:
     std::vector<ConstNodePtr> nodes_;
@@ -5,8 +5,8 @@
 
 #include <curl/curl.h>
 
-#include <QStandardPaths>
 #include <algorithm>
+#include <fstream>
 #include <memory>
 #include <nlohmann/json_fwd.hpp>
 #include <regex>
@@ -15,6 +15,8 @@
 #include "inja/inja.hpp"
 #include "label.hpp"
 #include "node.hpp"
+#include "templates.hpp"
+#include "trace.hpp"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -31,40 +33,18 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
 
 RstVisitor::RstVisitor(const Architecture &architecture, const string &_ws_path)
     : Visitor(architecture), ws_path(_ws_path) {
-  fs::path tpl_path;
-
-  for (auto p :
-       QStandardPaths::standardLocations(QStandardPaths::AppDataLocation)) {
-    tpl_path = fs::path(p.toStdString()) / "templates" / "rst";
-    cout << "Looking for .rst templates in " << tpl_path << endl;
-
-    if (fs::exists(tpl_path)) {
-      break;
-    }
-    tpl_path = "";
-  }
-
-  if (!tpl_path.empty()) {
-    cout << "Using reStructured templates found at " << tpl_path << endl;
-    env_ = make_unique<inja::Environment>(
-        tpl_path.string() + fs::path::preferred_separator,
-        ws_path.string() + fs::path::preferred_separator);
-
-    env_->set_line_statement("$$$$$");
-    env_->set_comment("{##", "##}"); // Comments
-    env_->set_trim_blocks(true);
-    env_->set_lstrip_blocks(true);
-
-    vector<string> tpls_to_copy{"index.rst"};
-    for (auto tpl : tpls_to_copy) {
-      fs::copy(tpl_path / tpl, ws_path / tpl);
-    }
-
-  } else {
-    cout << "[EE] reStructured templates not found! Can not generate "
-            "reStructured/Sphinx "
-            "project."
-         << endl;
+  env_ = make_unique<inja::Environment>(
+      "", ws_path.string() + fs::path::preferred_separator);
+
+  env_->set_line_statement("$$$$$");
+  env_->set_comment("{##", "##}"); // Comments
+  env_->set_trim_blocks(true);
+  env_->set_lstrip_blocks(true);
+
+  // copied as is
+  vector<string> tpls_to_copy{"index.rst"};
+  for (auto tpl : tpls_to_copy) {
+    ofstream(ws_path / tpl, ios::binary) << load_template("rst/" + tpl);
   }
 }
 
@@ -83,9 +63,6 @@ void RstVisitor::startUp() {
 }
 
 void RstVisitor::tearDown() {
-  if (!env_)
-    return;
-
   std::sort(data_["nodes"].begin(), data_["nodes"].end(),
             [](const nlohmann::json &n1, const nlohmann::json &n2) -> bool {
               return n1["id"] < n2["id"];
@@ -96,8 +73,11 @@ void RstVisitor::tearDown() {
   auto id = make_id(architecture.name);
 
   for (const auto &file : tpls) {
-    cout << "Generating " << file << "..." << endl;
-    auto tpl = env_->parse_template(file);
+    export_log() << "Generating " << file << "...";
+    auto tpl = traced("parse_template", "template", [&]() {
+      return env_->parse(load_template("rst/" + file));
+    });
+    TraceScope trace("write", "template");
     env_->write(tpl, data_, (ws_path / file).string());
   }
 
@@ -105,19 +85,23 @@ void RstVisitor::tearDown() {
   // Create all the nodes
   //
 
+  auto node_tpl = traced("parse_template", "template", [&]() {
+    return env_->parse(load_template("rst/node.rst"));
+  });
+
   for (auto node : data_["nodes"]) {
     string id(node["id"]);
-    cout << "Generating " << node["name"] << " as node [" << id << "]..."
-         << endl;
+    export_log() << "Generating " << node["name"] << " as node [" << id
+                 << "]...";
 
-    auto tpl = env_->parse_template("node.rst");
     // cout << "\t- " << (abs_path / file).string() << endl;
-    env_->write(tpl, node, (ws_path / (id + ".rst")).string());
+    TraceScope trace("write", "template");
+    env_->write(node_tpl, node, (ws_path / (id + ".rst")).string());
   }
 
-  cout << "Generation of reStructured project. The generated files can be "
-          "found in "
-       << ws_path << endl;
+  export_log() << "Generation of reStructured project. The generated "
+                  "files can be found in "
+               << ws_path;
 }
 
 void RstVisitor::beginNodes() {}
@@ -147,10 +131,9 @@ void RstVisitor::onNode(shared_ptr<const Node> node) {
     if (!node->sub_architecture ||
         node->sub_architecture->description.size() == 0) {
       jnode["generate"] = true;
-      cout << "ATTENTION! Node " << name
-           << " is not marked for mocking-up ('MOCK'), but no repo is "
-              "provided. Mocking it up anyway."
-           << endl;
+      export_log() << "ATTENTION! Node " << name
+                   << " is not marked for mocking-up ('MOCK'), but no repo is "
+                      "provided. Mocking it up anyway.";
     } else {
       jnode["generate"] = false;
 
@@ -169,6 +152,8 @@ void RstVisitor::onNode(shared_ptr<const Node> node) {
           curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
           curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
           curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+          TraceScope trace("FETCH_DOC", "network");
+          trace.arg("url", url);
           res = curl_easy_perform(curl);
           jnode["description"] = readBuffer;
           continue;
@@ -228,7 +213,7 @@ void RstVisitor::onNode(shared_ptr<const Node> node) {
 
     bool isInput = (p->direction == Port::Direction::IN);
 
-    auto name = p->name;
+    auto name = p->name.str();
     jport["name"] = name;
 
     regex topic_regex("^(/.*) \\[(.*)\\]$", regex_constants::ECMAScript);
@@ -247,10 +232,11 @@ void RstVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "subscribes to" : "publishes") << " topic "
-           << jport["topic"] << " (short: " << jport["short"] << ") of type "
-           << jport["type"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "subscribes to" : "publishes") << " topic "
+                   << jport["topic"] << " (short: " << jport["short"]
+                   << ") of type "
+                   << jport["type"];
 
     } else if (regex_search(name, tf_matches, tf_regex)) {
       jport["type"] = "tf";
@@ -265,9 +251,9 @@ void RstVisitor::onNode(shared_ptr<const Node> node) {
         jnode["dependencies"].push_back(jport["datatype"]);
       }
 
-      cout << "[II] Node " << jnode["id"] << ": "
-           << (isInput ? "listen to" : "broadcasts") << " TF frame "
-           << jport["frame"] << endl;
+      export_log() << "[II] Node " << jnode["id"] << ": "
+                   << (isInput ? "listen to" : "broadcasts") << " TF frame "
+                   << jport["frame"];
     } else {
       jport["type"] = "undefined";
       auto id = make_id(name);
@@ -0,0 +1,272 @@
+#include "search_index.hpp"
+
+#include <QObject>
+#include <algorithm>
+#include <cctype>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+string fold(const string &text) {
+  string folded(text);
+  transform(folded.begin(), folded.end(), folded.begin(),
+            [](unsigned char c) { return tolower(c); });
+  return folded;
+}
+
+// whether the characters of 'query' appear in order in 'text', and if so the
+// number of other characters in between (of the leftmost match)
+bool subsequence(const string &text, const string &query, size_t *gaps) {
+  size_t matched = 0, start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != query[matched]) {
+      continue;
+    }
+    if (matched == 0) {
+      start = i;
+    }
+    if (++matched == query.size()) {
+      *gaps = i + 1 - start - query.size();
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+SearchIndex::~SearchIndex() { clear(); }
+
+void SearchIndex::build(const Architecture &root) {
+  clear();
+  for (const auto &node : root.nodes()) {
+    add(root, node);
+  }
+  for (const auto &connection : root.connections()) {
+    add(root, connection);
+  }
+}
+
+void SearchIndex::clear() {
+  for (auto &kv : _nodes) {
+    QObject::disconnect(kv.second.dirty);
+  }
+  _nodes.clear();
+  _connections.clear();
+  _parents.clear();
+  _entries.clear();
+  _free.clear();
+  _folded.clear();
+}
+
+void SearchIndex::add(const Architecture &architecture,
+                      const ConstNodePtr &node) {
+  auto it = _nodes.find(node.get());
+  if (it != _nodes.end() && it->second.node.lock() == node) {
+    addSubArchitecture(node);
+    return;
+  }
+
+  // a node deleted without being removed from the index, whose address is
+  // reused
+  if (it != _nodes.end()) {
+    for (auto entry : it->second.entries) {
+      removeEntry(entry);
+    }
+    QObject::disconnect(it->second.dirty);
+    _nodes.erase(it);
+  }
+
+  auto &indexed = _nodes[node.get()];
+  indexed.node = node;
+  indexed.architecture = &architecture;
+  index(indexed);
+
+  const Node *key = node.get();
+  indexed.dirty = QObject::connect(node.get(), &Node::dirty, [this, key]() {
+    auto it = _nodes.find(key);
+    if (it != _nodes.end()) {
+      index(it->second);
+    }
+  });
+
+  addSubArchitecture(node);
+}
+
+void SearchIndex::addSubArchitecture(const ConstNodePtr &node) {
+  auto sub_architecture = node->sub_architecture.get();
+  if (!sub_architecture || _parents.count(sub_architecture)) {
+    return;
+  }
+
+  _parents[sub_architecture] = node;
+  for (const auto &child : sub_architecture->nodes()) {
+    add(*sub_architecture, child);
+  }
+  for (const auto &connection : sub_architecture->connections()) {
+    add(*sub_architecture, connection);
+  }
+}
+
+void SearchIndex::remove(const ConstNodePtr &node) {
+  if (!node) {
+    return;
+  }
+
+  auto it = _nodes.find(node.get());
+  if (it == _nodes.end()) {
+    return;
+  }
+  for (auto entry : it->second.entries) {
+    removeEntry(entry);
+  }
+  QObject::disconnect(it->second.dirty);
+  _nodes.erase(it);
+
+  auto sub_architecture = node->sub_architecture.get();
+  if (sub_architecture && _parents.erase(sub_architecture)) {
+    for (const auto &child : sub_architecture->nodes()) {
+      remove(child);
+    }
+    for (const auto &connection : sub_architecture->connections()) {
+      remove(connection);
+    }
+  }
+}
+
+void SearchIndex::add(const Architecture &architecture,
+                      const ConstConnectionPtr &connection) {
+  remove(connection);
+
+  auto from = connection->from.node.lock();
+  if (!from || connection->name.str().empty() ||
+      connection->name == Connection::ANONYMOUS) {
+    return;
+  }
+
+  vector<size_t> entries;
+  addEntry(SearchResult::Kind::CONNECTION, connection->name.str(), from,
+           &architecture, entries);
+  _connections[connection.get()] = entries.front();
+}
+
+void SearchIndex::remove(const ConstConnectionPtr &connection) {
+  auto it = _connections.find(connection.get());
+  if (it == _connections.end()) {
+    return;
+  }
+  removeEntry(it->second);
+  _connections.erase(it);
+}
+
+void SearchIndex::index(IndexedNode &indexed) {
+  for (auto entry : indexed.entries) {
+    removeEntry(entry);
+  }
+  indexed.entries.clear();
+
+  auto node = indexed.node.lock();
+  if (!node) {
+    return;
+  }
+
+  addEntry(SearchResult::Kind::NODE, node->name(), node, indexed.architecture,
+           indexed.entries);
+  for (const auto &port : node->ports()) {
+    addEntry(SearchResult::Kind::PORT, port->name.str(), node,
+             indexed.architecture, indexed.entries);
+  }
+}
+
+void SearchIndex::addEntry(SearchResult::Kind kind, const string &text,
+                           const ConstNodePtr &node,
+                           const Architecture *architecture,
+                           vector<size_t> &entries) {
+  // unnamed things can not be found
+  if (text.empty()) {
+    return;
+  }
+
+  size_t entry;
+  if (_free.empty()) {
+    entry = _entries.size();
+    _entries.emplace_back();
+    _folded.emplace_back();
+  } else {
+    entry = _free.back();
+    _free.pop_back();
+  }
+
+  _entries[entry] = {kind, text, node, architecture};
+  _folded[entry] = fold(text);
+  entries.push_back(entry);
+}
+
+void SearchIndex::removeEntry(size_t entry) {
+  _entries[entry] = Entry();
+  _folded[entry].clear();
+  _free.push_back(entry);
+}
+
+vector<ConstNodePtr> SearchIndex::path(const Architecture *architecture) const {
+  vector<ConstNodePtr> result;
+  for (auto parent = _parents.find(architecture); parent != _parents.end();
+       parent = _parents.find(architecture)) {
+    auto node = parent->second.lock();
+    auto indexed = node ? _nodes.find(node.get()) : _nodes.end();
+    if (indexed == _nodes.end()) {
+      break;
+    }
+    result.push_back(node);
+    architecture = indexed->second.architecture;
+  }
+  reverse(result.begin(), result.end());
+  return result;
+}
+
+vector<SearchResult> SearchIndex::search(const string &query,
+                                         size_t limit) const {
+  auto folded = fold(query);
+  if (folded.empty() || limit == 0) {
+    return {};
+  }
+
+  // (rank, gaps, length, entry): the whole name, then names starting with
+  // the query, containing it, and containing its characters in order
+  typedef tuple<int, size_t, size_t, size_t> Match;
+  vector<Match> matches;
+
+  for (size_t i = 0; i < _folded.size(); i++) {
+    const auto &text = _folded[i];
+    if (text.size() < folded.size()) {
+      continue;
+    }
+
+    auto position = text.find(folded);
+    size_t gaps;
+    if (position == 0) {
+      matches.emplace_back(text.size() == folded.size() ? 0 : 1, 0,
+                           text.size(), i);
+    } else if (position != string::npos) {
+      matches.emplace_back(2, position, text.size(), i);
+    } else if (subsequence(text, folded, &gaps)) {
+      matches.emplace_back(3, gaps, text.size(), i);
+    }
+  }
+
+  auto end = matches.begin() + min(limit, matches.size());
+  partial_sort(matches.begin(), end, matches.end());
+
+  vector<SearchResult> results;
+  for (auto it = matches.begin(); it != end; ++it) {
+    const auto &entry = _entries[get<3>(*it)];
+    auto node = entry.node.lock();
+    if (!node) {
+      continue;
+    }
+    results.push_back({entry.kind, entry.text, node, path(entry.architecture)});
+  }
+  return results;
+}
@@ -0,0 +1,131 @@
+#ifndef SEARCH_INDEX_HPP
+#define SEARCH_INDEX_HPP
+
+#include <QMetaObject>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "architecture.hpp"
+
+/**
+ * A match of a search: a node, a port or a connection (named, ie not
+ * 'anonymous').
+ */
+struct SearchResult {
+  enum class Kind { NODE, PORT, CONNECTION };
+
+  Kind kind;
+  std::string text;
+
+  // the node to show: the node itself, the node of the port, or the origin
+  // of the connection
+  ConstNodePtr node;
+
+  // the nodes whose sub-architectures lead to 'node', outermost first
+  // (empty if 'node' is part of the root architecture)
+  std::vector<ConstNodePtr> path;
+};
+
+/**
+ * Index of the names of the nodes, ports and connections of a whole
+ * hierarchy of architectures, for the search box.
+ *
+ * The index is incremental: nodes and connections are (re-)indexed one at a
+ * time, and the indexed nodes are re-indexed by themselves when they change
+ * (Node::dirty: renamed, ports added, renamed or removed). The additions and
+ * removals of nodes and connections have to be reported (add(), remove()).
+ *
+ * Searches are case-insensitive, and match the names starting with the
+ * query first, then the names containing it, and then the names containing
+ * its characters in order ('fcdt' matches 'face detector'), the tightest
+ * matches first. A search scans the folded names once: a few milliseconds
+ * for 100k names.
+ */
+class SearchIndex {
+public:
+  SearchIndex() = default;
+  ~SearchIndex();
+
+  // the nodes notify the index itself
+  SearchIndex(const SearchIndex &) = delete;
+  SearchIndex &operator=(const SearchIndex &) = delete;
+
+  /**
+   * Indexes the whole hierarchy of 'root', replacing the current content of
+   * the index.
+   */
+  void build(const Architecture &root);
+
+  void clear();
+
+  /**
+   * Indexes a node of 'architecture' (with its sub-architecture, if any).
+   * Nothing is done for a node already indexed, except indexing its
+   * sub-architecture if it has been created since.
+   */
+  void add(const Architecture &architecture, const ConstNodePtr &node);
+
+  /**
+   * Removes a node, and the content of its sub-architecture.
+   */
+  void remove(const ConstNodePtr &node);
+
+  /**
+   * Indexes (or re-indexes, eg once renamed) a connection of 'architecture'.
+   */
+  void add(const Architecture &architecture,
+           const ConstConnectionPtr &connection);
+  void remove(const ConstConnectionPtr &connection);
+
+  /**
+   * Returns at most 'limit' matches of 'query', best matches first.
+   */
+  std::vector<SearchResult> search(const std::string &query,
+                                   size_t limit) const;
+
+  // the number of indexed names
+  size_t size() const { return _entries.size() - _free.size(); }
+
+private:
+  struct Entry {
+    SearchResult::Kind kind;
+    std::string text;
+    std::weak_ptr<const Node> node;
+    const Architecture *architecture;
+  };
+
+  struct IndexedNode {
+    std::weak_ptr<const Node> node;
+    const Architecture *architecture;
+    std::vector<size_t> entries;
+    QMetaObject::Connection dirty;
+  };
+
+  void index(IndexedNode &indexed);
+  void addEntry(SearchResult::Kind kind, const std::string &text,
+                const ConstNodePtr &node, const Architecture *architecture,
+                std::vector<size_t> &entries);
+  void removeEntry(size_t entry);
+  void addSubArchitecture(const ConstNodePtr &node);
+
+  std::vector<ConstNodePtr> path(const Architecture *architecture) const;
+
+  // entries are recycled: the positions of the removed ones are reused
+  std::vector<Entry> _entries;
+  std::vector<size_t> _free;
+
+  // the lowercase names of the entries (empty for the free ones), apart
+  // from the rest to be scanned quickly
+  std::vector<std::string> _folded;
+
+  std::unordered_map<const Node *, IndexedNode> _nodes;
+  std::unordered_map<const Connection *, size_t> _connections;
+
+  // the node holding each indexed sub-architecture
+  std::unordered_map<const Architecture *, std::weak_ptr<const Node>>
+      _parents;
+};
+
+#endif // SEARCH_INDEX_HPP
@@ -0,0 +1,426 @@
+#include "select.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <regex>
+#include <set>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const map<string, Port::Type> PORT_TYPES{{"explicit", Port::Type::EXPLICIT},
+                                         {"latent", Port::Type::LATENT},
+                                         {"event", Port::Type::EVENT},
+                                         {"other", Port::Type::OTHER}};
+
+// intermediate results of a query, by address
+struct Set {
+  unordered_map<const Node *, ConstNodePtr> nodes;
+  unordered_map<const Connection *, ConstConnectionPtr> connections;
+
+  void add(const ConstNodePtr &node) { nodes.emplace(node.get(), node); }
+
+  // with the nodes it links
+  void add(const ConstConnectionPtr &connection) {
+    auto from = connection->from.node.lock();
+    auto to = connection->to.node.lock();
+    if (!from || !to) {
+      return;
+    }
+    connections.emplace(connection.get(), connection);
+    add(from);
+    add(to);
+  }
+};
+
+Set unite(Set a, Set b) {
+  if (a.nodes.size() + a.connections.size() <
+      b.nodes.size() + b.connections.size()) {
+    swap(a, b);
+  }
+  a.nodes.insert(b.nodes.begin(), b.nodes.end());
+  a.connections.insert(b.connections.begin(), b.connections.end());
+  return a;
+}
+
+template <class Map> Map intersect(const Map &a, const Map &b) {
+  if (a.size() > b.size()) {
+    return intersect(b, a);
+  }
+  Map result;
+  for (const auto &kv : a) {
+    if (b.count(kv.first)) {
+      result.insert(kv);
+    }
+  }
+  return result;
+}
+
+Set intersect(const Set &a, const Set &b) {
+  return {intersect(a.nodes, b.nodes),
+          intersect(a.connections, b.connections)};
+}
+
+string lower(string text) {
+  transform(text.begin(), text.end(), text.begin(),
+            [](unsigned char c) { return tolower(c); });
+  return text;
+}
+
+} // namespace
+
+/**
+ * Recursive descent parser of the queries, evaluating them as it goes.
+ *
+ *   query  := term ('|' term)*
+ *   term   := factor ('&' factor)*
+ *   factor := '(' query ')' | ('upstream' | 'downstream') '(' query ')'
+ *           | 'name' '~' value | key ':' value
+ */
+class Selector::Parser {
+public:
+  Parser(const Selector &selector, const string &query)
+      : _selector(selector), _query(query), _pos(0) {}
+
+  Set parse() {
+    auto set = query();
+    skipSpaces();
+    if (_pos < _query.size()) {
+      error(string("unexpected '") + _query[_pos] + "'");
+    }
+    return set;
+  }
+
+private:
+  Set query() {
+    auto set = term();
+    while (accept('|')) {
+      set = unite(std::move(set), term());
+    }
+    return set;
+  }
+
+  Set term() {
+    auto set = factor();
+    while (accept('&')) {
+      set = intersect(set, factor());
+    }
+    return set;
+  }
+
+  Set factor() {
+    if (accept('(')) {
+      auto set = query();
+      expect(')');
+      return set;
+    }
+
+    auto start = _pos;
+    auto key = word();
+
+    if (key == "upstream" || key == "downstream") {
+      expect('(');
+      auto set = query();
+      expect(')');
+      return reach(set, key == "downstream");
+    }
+
+    if (key == "name" && accept('~')) {
+      return matching(value());
+    }
+
+    expect(':');
+
+    if (key == "label") {
+      return nodes(_selector._by_label, label(value()));
+    } else if (key == "name") {
+      return nodes(_selector._by_name, value());
+    } else if (key == "port") {
+      auto type = PORT_TYPES.find(lower(value()));
+      if (type == PORT_TYPES.end()) {
+        error("unknown port type (explicit, latent, event or other)");
+      }
+      return nodes(_selector._by_port_type, type->second);
+    } else if (key == "datatype") {
+      return connections(_selector._by_datatype, value());
+    } else if (key == "topic") {
+      return connections(_selector._by_topic, value());
+    }
+
+    _pos = start;
+    error("unknown term <" + key + ">");
+  }
+
+  template <class Index, class Key>
+  Set nodes(const Index &index, const Key &key) const {
+    Set set;
+    auto it = index.find(key);
+    if (it != index.end()) {
+      for (const auto &node : it->second) {
+        set.add(node);
+      }
+    }
+    return set;
+  }
+
+  template <class Index>
+  Set connections(const Index &index, const string &key) const {
+    Set set;
+    auto it = index.find(key);
+    if (it != index.end()) {
+      for (const auto &connection : it->second) {
+        set.add(connection);
+      }
+    }
+    return set;
+  }
+
+  Set matching(const string &pattern) {
+    regex name_regex;
+    try {
+      name_regex = regex(pattern, regex_constants::ECMAScript);
+    } catch (const regex_error &e) {
+      error("invalid regex: " + string(e.what()));
+    }
+
+    Set set;
+    for (const auto &kv : _selector._by_name) {
+      if (regex_search(kv.first, name_regex)) {
+        for (const auto &node : kv.second) {
+          set.add(node);
+        }
+      }
+    }
+    return set;
+  }
+
+  Set reach(const Set &set, bool downstream) const {
+    Graph::NodeList starts;
+    for (const auto &kv : set.nodes) {
+      starts.push_back(kv.second);
+    }
+
+    Set result;
+    for (const auto &node : downstream ? _selector._graph.downstream(starts)
+                                       : _selector._graph.upstream(starts)) {
+      result.add(node);
+    }
+
+    for (const auto &kv : result.nodes) {
+      auto outgoing = _selector._outgoing.find(kv.first);
+      if (outgoing == _selector._outgoing.end()) {
+        continue;
+      }
+      for (const auto &connection : outgoing->second) {
+        if (result.nodes.count(connection->to.node.lock().get())) {
+          result.connections.emplace(connection.get(), connection);
+        }
+      }
+    }
+    return result;
+  }
+
+  Label label(const string &name) {
+    for (const auto &kv : LABEL_NAMES) {
+      if (lower(kv.second) == lower(name)) {
+        return kv.first;
+      }
+    }
+
+    string labels;
+    for (const auto &kv : LABEL_NAMES) {
+      labels += (labels.empty() ? "" : ", ") + kv.second;
+    }
+    error("unknown label (" + labels + ")");
+  }
+
+  void skipSpaces() {
+    while (_pos < _query.size() && isspace(_query[_pos])) {
+      _pos++;
+    }
+  }
+
+  bool accept(char c) {
+    skipSpaces();
+    if (_pos < _query.size() && _query[_pos] == c) {
+      _pos++;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c) {
+    if (!accept(c)) {
+      error(string("expected '") + c + "'");
+    }
+  }
+
+  string word() {
+    skipSpaces();
+    auto start = _pos;
+    while (_pos < _query.size() && islower(_query[_pos])) {
+      _pos++;
+    }
+    if (_pos == start) {
+      error("expected a term");
+    }
+    return _query.substr(start, _pos - start);
+  }
+
+  string value() {
+    skipSpaces();
+    string result;
+
+    if (_pos < _query.size() && _query[_pos] == '"') {
+      for (_pos++; _pos < _query.size() && _query[_pos] != '"'; _pos++) {
+        if (_query[_pos] == '\\' && _pos + 1 < _query.size()) {
+          _pos++;
+        }
+        result += _query[_pos];
+      }
+      expect('"');
+      return result;
+    }
+
+    while (_pos < _query.size() && !isspace(_query[_pos]) &&
+           string("()&|").find(_query[_pos]) == string::npos) {
+      result += _query[_pos++];
+    }
+    if (result.empty()) {
+      error("expected a value");
+    }
+    return result;
+  }
+
+  [[noreturn]] void error(const string &message) const {
+    throw runtime_error("Invalid query at position " + to_string(_pos + 1) +
+                        ": " + message + "\n  " + _query + "\n  " +
+                        string(_pos, ' ') + "^");
+  }
+
+  const Selector &_selector;
+  const string &_query;
+  size_t _pos;
+};
+
+Selector::Selector(const Architecture &architecture) : _graph(architecture) {
+  size_t position = 0;
+  for (const auto &node : architecture.nodes()) {
+    _node_positions[node.get()] = position++;
+    _by_label[node->label()].push_back(node);
+    _by_name[node->name()].push_back(node);
+
+    set<Port::Type> types;
+    for (const auto &port : node->ports()) {
+      types.insert(port->type);
+    }
+    for (auto type : types) {
+      _by_port_type[type].push_back(node);
+    }
+  }
+
+  // ROS ports are named '/topic [package/Message]' (see RosVisitor)
+  static const regex topic_regex("^(/.*) \\[(.*)\\]$",
+                                 regex_constants::ECMAScript);
+
+  position = 0;
+  for (const auto &connection : architecture.connections()) {
+    _connection_positions[connection.get()] = position++;
+
+    auto from = connection->from.node.lock();
+    if (from) {
+      _outgoing[from.get()].push_back(connection);
+    }
+
+    // the topic is given by the port at either end, the origin first
+    for (const auto &socket : {connection->from, connection->to}) {
+      auto port = socket.port.lock();
+      smatch matches;
+      if (!port || port->name.str().empty() || port->name.str()[0] != '/' ||
+          !regex_match(port->name.str(), matches, topic_regex)) {
+        continue;
+      }
+
+      _by_topic[matches[1].str()].push_back(connection);
+
+      auto datatype = matches[2].str();
+      _by_datatype[datatype].push_back(connection);
+      auto slash = datatype.find('/');
+      if (slash != string::npos) {
+        _by_datatype[datatype.substr(0, slash)].push_back(connection);
+      }
+      break;
+    }
+  }
+}
+
+Selection Selector::select(const string &query) const {
+  auto set = Parser(*this, query).parse();
+
+  Selection selection;
+  for (const auto &kv : set.nodes) {
+    selection.nodes.push_back(kv.second);
+  }
+  sort(selection.nodes.begin(), selection.nodes.end(),
+       [this](const ConstNodePtr &a, const ConstNodePtr &b) {
+         return _node_positions.at(a.get()) < _node_positions.at(b.get());
+       });
+
+  for (const auto &kv : set.connections) {
+    selection.connections.push_back(kv.second);
+  }
+  sort(selection.connections.begin(), selection.connections.end(),
+       [this](const ConstConnectionPtr &a, const ConstConnectionPtr &b) {
+         return _connection_positions.at(a.get()) <
+                _connection_positions.at(b.get());
+       });
+
+  return selection;
+}
+
+unique_ptr<Architecture> extract(const Architecture &architecture,
+                                 const Selection &selection) {
+  unique_ptr<Architecture> subgraph(new Architecture(architecture.uuid));
+  subgraph->name = architecture.name;
+  subgraph->version = architecture.version;
+  subgraph->description = architecture.description;
+  subgraph->filename = architecture.filename;
+
+  unordered_map<const Node *, NodePtr> copies;
+  for (const auto &node : selection.nodes) {
+    auto copy = subgraph->createNode(node->uuid, true);
+    copy->name(node->name());
+    copy->label(node->label());
+    copy->x(node->x());
+    copy->y(node->y());
+    copy->width(node->width());
+    copy->height(node->height());
+    copy->sub_architecture = node->sub_architecture;
+
+    for (const auto &port : node->ports()) {
+      copy->createPort(*port);
+    }
+    copies[node.get()] = copy;
+  }
+
+  for (const auto &connection : selection.connections) {
+    auto from = copies.find(connection->from.node.lock().get());
+    auto to = copies.find(connection->to.node.lock().get());
+    auto from_port = connection->from.port.lock();
+    auto to_port = connection->to.port.lock();
+    if (from == copies.end() || to == copies.end() || !from_port ||
+        !to_port) {
+      continue;
+    }
+
+    auto copy = subgraph->createConnection(
+        connection->uuid,
+        {from->second, from->second->port(from_port->name.str())},
+        {to->second, to->second->port(to_port->name.str())});
+    copy->name = connection->name;
+  }
+
+  return subgraph;
+}
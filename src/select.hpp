@@ -0,0 +1,89 @@
+#ifndef SELECT_HPP
+#define SELECT_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "architecture.hpp"
+#include "graph.hpp"
+
+/**
+ * A subgraph of an architecture: nodes, and connections between them, in
+ * the order of the architecture.
+ */
+struct Selection {
+  Graph::NodeList nodes;
+  std::vector<ConstConnectionPtr> connections;
+};
+
+/**
+ * Selection of subgraphs of an architecture (not including the content of
+ * the sub-architectures: flatten it first) with queries like:
+ *
+ *   downstream(label:"Social perception")
+ *   datatype:sensor_msgs | (port:event & name~"^hw: ")
+ *
+ * Terms:
+ * - label:<label>      nodes with this label (see label.hpp; any case)
+ * - name:<name>        nodes with this name
+ * - name~<regex>       nodes whose name matches the (ECMAScript) regex
+ * - port:<type>        nodes with a port of this type (explicit, latent,
+ *                      event or other)
+ * - datatype:<type>    connections carrying a ROS datatype (ports named
+ *                      '/topic [package/Message]'), given as
+ *                      package/Message or package; with the nodes they link
+ * - topic:<topic>      connections carrying this topic, with their nodes
+ * - upstream(<query>), downstream(<query>)
+ *                      the nodes of the query, and all the nodes they depend
+ *                      on (resp. that depend on them), directly or not, with
+ *                      the connections between them
+ *
+ * combined with '&' (intersection), '|' (union) and parentheses. Values can
+ * be quoted ("...", with \" and \\ escapes), or else end at the first space
+ * or operator.
+ *
+ * The selector indexes the nodes and connections by label, name, port type,
+ * datatype and topic once: a query then runs in time proportional to the
+ * size of its result (and of its intermediate results), except for name~
+ * which tests every distinct name. The selector is a snapshot: changes made
+ * to the architecture afterwards are not reflected.
+ */
+class Selector {
+public:
+  explicit Selector(const Architecture &architecture);
+
+  /**
+   * Throws a runtime_error if the query is invalid.
+   */
+  Selection select(const std::string &query) const;
+
+private:
+  class Parser;
+
+  Graph _graph;
+
+  std::map<Label, Graph::NodeList> _by_label;
+  std::map<std::string, Graph::NodeList> _by_name;
+  std::map<Port::Type, Graph::NodeList> _by_port_type;
+  std::map<std::string, std::vector<ConstConnectionPtr>> _by_datatype;
+  std::map<std::string, std::vector<ConstConnectionPtr>> _by_topic;
+
+  std::unordered_map<const Node *, std::vector<ConstConnectionPtr>>
+      _outgoing;
+
+  // positions in the architecture, to sort the results
+  std::unordered_map<const Node *, size_t> _node_positions;
+  std::unordered_map<const Connection *, size_t> _connection_positions;
+};
+
+/**
+ * Returns a copy of the selected subgraph (same UUIDs, names and labels),
+ * eg to export it.
+ */
+std::unique_ptr<Architecture> extract(const Architecture &architecture,
+                                      const Selection &selection);
+
+#endif // SELECT_HPP
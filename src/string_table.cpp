@@ -0,0 +1,40 @@
+#include "string_table.hpp"
+
+#include "memory_stats.hpp"
+
+using namespace std;
+
+namespace {
+const shared_ptr<const string>& empty_name() {
+    static const auto empty = make_shared<const string>();
+    return empty;
+}
+}  // namespace
+
+Name::Name() : _name(empty_name()) {}
+
+Name::Name(const string& name) : _name(make_shared<const string>(name)) {}
+
+Name::Name(const char* name) : _name(make_shared<const string>(name)) {}
+
+StringTable::~StringTable() {
+    MemoryStats::released(MemoryCategory::STRINGS, _bytes);
+}
+
+Name StringTable::intern(const string& name) {
+    auto it = _names.find(name);
+    if (it != _names.end()) return it->second;
+
+    Name interned(make_shared<const string>(name));
+    _names.emplace(interned.str(), interned);
+
+    // the string and its shared_ptr control block, and the index entry
+    // (a view, a Name and the next pointer)
+    auto bytes = sizeof(string) + 2 * sizeof(void*) + sizeof(string_view) +
+                 sizeof(Name) + sizeof(void*);
+    if (name.size() > string().capacity()) bytes += name.size() + 1;
+    _bytes += bytes;
+    MemoryStats::allocated(MemoryCategory::STRINGS, bytes);
+
+    return interned;
+}
@@ -0,0 +1,112 @@
+#ifndef STRING_TABLE_HPP
+#define STRING_TABLE_HPP
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Immutable string, cheap to copy: copies share the same characters.
+ *
+ * Names interned in the same StringTable share their characters with every
+ * other occurrence of the same string, and compare equal by pointer. Names
+ * built directly from a std::string (eg, edited in the GUI) are not
+ * interned, and are compared by value.
+ */
+class Name {
+   public:
+    Name();
+    Name(const std::string& name);
+    Name(const char* name);
+
+    const std::string& str() const { return *_name; }
+    operator const std::string&() const { return *_name; }
+
+    bool empty() const { return _name->empty(); }
+
+    friend bool operator==(const Name& l, const Name& r) {
+        return l._name == r._name || *l._name == *r._name;
+    }
+    friend bool operator==(const Name& l, const std::string& r) {
+        return *l._name == r;
+    }
+    friend bool operator==(const std::string& l, const Name& r) {
+        return l == *r._name;
+    }
+    friend bool operator==(const Name& l, const char* r) {
+        return *l._name == r;
+    }
+    template <class T>
+    friend bool operator!=(const Name& l, const T& r) {
+        return !(l == r);
+    }
+    friend bool operator!=(const std::string& l, const Name& r) {
+        return !(r == l);
+    }
+
+    friend bool operator<(const Name& l, const Name& r) {
+        return l._name != r._name && *l._name < *r._name;
+    }
+    friend bool operator<(const Name& l, const std::string& r) {
+        return *l._name < r;
+    }
+    friend bool operator<(const std::string& l, const Name& r) {
+        return l < *r._name;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Name& name) {
+        return os << *name._name;
+    }
+
+   private:
+    friend class StringTable;
+
+    explicit Name(std::shared_ptr<const std::string> name)
+        : _name(std::move(name)) {}
+
+    std::shared_ptr<const std::string> _name;
+};
+
+namespace std {
+template <>
+struct hash<Name> {
+    size_t operator()(const Name& name) const {
+        return hash<string>()(name.str());
+    }
+};
+}  // namespace std
+
+/**
+ * Set of interned strings, shared by an architecture and its
+ * sub-architectures: the port and connection names repeated across the
+ * nodes of a model (topics, TF frames,...) are stored only once.
+ *
+ * The interned strings are accounted as MemoryCategory::STRINGS (see
+ * MemoryStats), until the table is destroyed.
+ *
+ * A StringTable is not thread-safe.
+ */
+class StringTable {
+   public:
+    StringTable() = default;
+    ~StringTable();
+
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    Name intern(const std::string& name);
+
+    size_t size() const { return _names.size(); }
+
+   private:
+    // keys are views on the interned strings themselves
+    std::unordered_map<std::string_view, Name> _names;
+
+    // approximate memory held by the interned strings and the index
+    size_t _bytes = 0;
+};
+
+#endif  // STRING_TABLE_HPP
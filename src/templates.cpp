@@ -0,0 +1,66 @@
+#include "templates.hpp"
+
+#include <QStandardPaths>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// the templates directory is looked up once: without overrides, loading a
+// template does not touch the filesystem
+bool has_templates_dir() {
+  static const bool exists = fs::is_directory(templates_dir());
+  return exists;
+}
+
+fs::path override_path(const string &name) {
+  if (!has_templates_dir()) {
+    return {};
+  }
+  auto path = templates_dir() / name;
+  return fs::is_regular_file(path) ? path : fs::path();
+}
+
+} // namespace
+
+const fs::path &templates_dir() {
+  static const fs::path dir = []() {
+    auto env = getenv("BOXOLOGY_TEMPLATES");
+    if (env && *env) {
+      return fs::path(env);
+    }
+    return fs::path(QStandardPaths::writableLocation(
+                        QStandardPaths::AppDataLocation)
+                        .toStdString()) /
+           "templates";
+  }();
+  return dir;
+}
+
+bool has_template(const string &name) {
+  return embedded_templates().count(name) || !override_path(name).empty();
+}
+
+string load_template(const string &name) {
+  auto path = override_path(name);
+  if (!path.empty()) {
+    cerr << "Using template " << path << " instead of the shipped one"
+         << endl;
+    ifstream file(path, ios::binary);
+    stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  auto embedded = embedded_templates().find(name);
+  if (embedded == embedded_templates().end()) {
+    throw runtime_error("No template named " + name);
+  }
+  return string(embedded->second);
+}
@@ -0,0 +1,46 @@
+#ifndef TEMPLATES_HPP
+#define TEMPLATES_HPP
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+/**
+ * The templates of the exporters.
+ *
+ * The templates shipped in templates/ are embedded in the executable at build
+ * time (see cmake/embed_templates.cmake): the exporters do not need them to
+ * be installed, nor to look for them on disk.
+ *
+ * Each of them can still be overridden by a file with the same relative
+ * path (eg "ros/default/package.xml") in the templates directory:
+ * $BOXOLOGY_TEMPLATES if set, or else the 'templates' directory of the
+ * user's application data (eg ~/.local/share/boxology/templates).
+ */
+
+/**
+ * The templates directory (which may not exist).
+ */
+const std::filesystem::path &templates_dir();
+
+/**
+ * True if there is a template with this name, on disk or embedded.
+ */
+bool has_template(const std::string &name);
+
+/**
+ * Returns the content of a template: from the templates directory if it
+ * overrides it, from the embedded templates otherwise.
+ *
+ * Throws a runtime_error if there is no such template.
+ */
+std::string load_template(const std::string &name);
+
+/**
+ * The templates embedded at build time, by relative path (generated by
+ * cmake/embed_templates.cmake).
+ */
+const std::map<std::string, std::string_view> &embedded_templates();
+
+#endif // TEMPLATES_HPP
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <boost/algorithm/string.hpp> // for search and replace
+#include <cmath>
 #include <string>
 
 #include "label.hpp"
@@ -132,7 +133,7 @@ void TikzVisitor::onConnection(shared_ptr<const Connection> connection) {
   auto [from_id, from_id_capitalized] = get_id(from->uuid);
   auto [to_id, to_id_capitalized] = get_id(to->uuid);
 
-  auto name = connection->name;
+  auto name = connection->name.str();
   trim(name);
 
   auto edge_type = get_edge_type(name);
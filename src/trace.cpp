@@ -0,0 +1,93 @@
+#include "trace.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#include "json/json.h"
+
+using namespace std;
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point end;
+    size_t thread;
+    vector<pair<const char*, string>> args;
+};
+
+mutex events_mutex;
+vector<Event> events;
+chrono::steady_clock::time_point origin;
+
+// small, stable thread ids (the first thread tracing an event is thread 1)
+size_t thread_index() {
+    static atomic<size_t> threads{0};
+    thread_local size_t index = ++threads;
+    return index;
+}
+
+double microseconds(chrono::steady_clock::duration duration) {
+    return chrono::duration<double, micro>(duration).count();
+}
+
+}  // namespace
+
+atomic<bool> TraceSession::_enabled{false};
+
+TraceSession::TraceSession(const string& path) : _path(path) {
+    {
+        lock_guard<mutex> lock(events_mutex);
+        events.clear();
+        origin = chrono::steady_clock::now();
+    }
+    _enabled = true;
+}
+
+TraceSession::~TraceSession() {
+    _enabled = false;
+
+    lock_guard<mutex> lock(events_mutex);
+
+    Json::Value trace;
+    trace["displayTimeUnit"] = "ms";
+    auto& jevents = trace["traceEvents"];
+    jevents = Json::Value(Json::arrayValue);
+
+    for (const auto& event : events) {
+        Json::Value jevent;
+        jevent["name"] = event.name;
+        jevent["cat"] = event.category;
+        jevent["ph"] = "X";
+        jevent["ts"] = microseconds(event.start - origin);
+        jevent["dur"] = microseconds(event.end - event.start);
+        jevent["pid"] = 1;
+        jevent["tid"] = Json::UInt64(event.thread);
+        for (const auto& arg : event.args) {
+            jevent["args"][arg.first] = arg.second;
+        }
+        jevents.append(jevent);
+    }
+
+    ofstream file(_path);
+    if (!file) {
+        cerr << "Unable to write the trace to " << _path << endl;
+        return;
+    }
+    Json::FastWriter writer;
+    file << writer.write(trace);
+
+    events.clear();
+}
+
+void TraceScope::finish() {
+    auto end = chrono::steady_clock::now();
+    auto thread = thread_index();
+
+    lock_guard<mutex> lock(events_mutex);
+    events.push_back(
+        {_name, _category, _start, end, thread, std::move(_args)});
+}
@@ -0,0 +1,80 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Records where the time goes (loading, exports, GUI), and writes it in the
+ * Chrome trace event format (to open in chrome://tracing, or
+ * https://ui.perfetto.dev).
+ *
+ * Events are only recorded while a TraceSession is alive: otherwise, a
+ * TraceScope only tests a flag.
+ */
+class TraceSession {
+   public:
+    // the trace is written to 'path' when the session ends
+    explicit TraceSession(const std::string& path);
+    ~TraceSession();
+
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+   private:
+    static std::atomic<bool> _enabled;
+
+    std::string _path;
+};
+
+/**
+ * Records the duration of the enclosing scope, as a 'complete' trace event.
+ *
+ * 'name' and 'category' are not copied: they must be string literals.
+ */
+class TraceScope {
+   public:
+    TraceScope(const char* name, const char* category)
+        : _name(name),
+          _category(category),
+          _enabled(TraceSession::enabled()) {
+        if (_enabled) _start = std::chrono::steady_clock::now();
+    }
+    ~TraceScope() {
+        if (_enabled) finish();
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // arguments are costly to compute: test enabled() first
+    bool enabled() const { return _enabled; }
+    void arg(const char* key, const std::string& value) {
+        if (_enabled) _args.emplace_back(key, value);
+    }
+
+   private:
+    void finish();
+
+    const char* _name;
+    const char* _category;
+    bool _enabled;
+    std::chrono::steady_clock::time_point _start;
+    std::vector<std::pair<const char*, std::string>> _args;
+};
+
+/**
+ * Returns f(), traced as 'name'.
+ */
+template <class F>
+auto traced(const char* name, const char* category, F&& f) {
+    TraceScope trace(name, category);
+    return f();
+}
+
+#endif  // TRACE_HPP
@@ -0,0 +1,81 @@
+#include "uuid_generator.hpp"
+
+#include <atomic>
+#include <boost/uuid/random_generator.hpp>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+// 0 while the generators are seeded from the system entropy source;
+// incremented each time seed_uuids() is called
+atomic<unsigned int> seed_generation{0};
+atomic<unsigned int> uuid_seed{0};
+// order in which the threads get re-seeded, in deterministic mode
+atomic<unsigned int> thread_ordinal{0};
+
+struct Generator {
+    // forces the seeding on first use
+    unsigned int generation = UINT_MAX;
+
+    mt19937 engine;
+    boost::uuids::basic_random_generator<mt19937> generate{engine};
+
+    void seed() {
+        auto current = seed_generation.load();
+        if (current == generation) return;
+
+        if (current == 0) {
+            random_device entropy;
+            seed_seq seq{entropy(), entropy(), entropy(), entropy(),
+                         entropy(), entropy(), entropy(), entropy()};
+            engine.seed(seq);
+        } else {
+            seed_seq seq{uuid_seed.load(), thread_ordinal++};
+            engine.seed(seq);
+        }
+        generation = current;
+    }
+};
+
+bool seed_from_environment() {
+    auto seed = getenv("BOXOLOGY_UUID_SEED");
+    if (!seed) return false;
+
+    // a malformed seed must not make the first UUID throw
+    char* end;
+    errno = 0;
+    auto value = strtoul(seed, &end, 10);
+    if (end == seed || *end != '\0' || errno == ERANGE || value > UINT_MAX) {
+        cerr << "Ignoring BOXOLOGY_UUID_SEED=" << seed
+             << " (expected an unsigned integer): UUIDs are random" << endl;
+        return false;
+    }
+
+    seed_uuids(static_cast<unsigned int>(value));
+    return true;
+}
+
+}  // namespace
+
+boost::uuids::uuid make_uuid() {
+    static const bool from_environment = seed_from_environment();
+    (void)from_environment;
+
+    thread_local Generator generator;
+    generator.seed();
+    return generator.generate();
+}
+
+void seed_uuids(unsigned int seed) {
+    uuid_seed = seed;
+    thread_ordinal = 0;
+
+    // never back to 0 (ie, random seeding)
+    if (++seed_generation == 0) ++seed_generation;
+}
@@ -0,0 +1,25 @@
+#ifndef UUID_GENERATOR_HPP
+#define UUID_GENERATOR_HPP
+
+#include <boost/uuid/uuid.hpp>
+
+/**
+ * Returns a new random UUID.
+ *
+ * Each thread owns a generator, seeded only once (from the system entropy
+ * source): unlike constructing a boost::uuids::random_generator for each
+ * UUID, generating a UUID is cheap.
+ */
+boost::uuids::uuid make_uuid();
+
+/**
+ * Makes the UUIDs deterministic, for reproducible test fixtures: the
+ * generator of each thread is re-seeded from 'seed' (and from the order in
+ * which the threads generate their first UUID after that call).
+ *
+ * The deterministic mode can also be enabled by setting the
+ * BOXOLOGY_UUID_SEED environment variable to the seed.
+ */
+void seed_uuids(unsigned int seed);
+
+#endif  // UUID_GENERATOR_HPP
@@ -194,7 +194,11 @@ void GraphicsDirectedEdge::setConnectionName(const QString& name) {
     }
 
     // update the underlying name of the connection
-    _connection.lock()->name = name.toStdString();
+    auto connection = _connection.lock();
+    connection->name = name.toStdString();
+
+    auto nodescene = dynamic_cast<GraphicsNodeScene*>(scene());
+    if (nodescene) emit nodescene->connectionChanged(connection);
 }
 
 void GraphicsBezierEdge::update_path() {
@@ -22,7 +22,9 @@
 #include <memory>
 #include <tuple>
 
+#include "../app/commands.hpp"
 #include "../app/mainwindow.hpp"
+#include "../memory_stats.hpp"
 #include "edge.hpp"
 #include "editablelabel.hpp"
 #include "scene.hpp"
@@ -242,16 +244,18 @@ shared_ptr<const GraphicsNodeSocket> GraphicsNode::add_socket(PortPtr port) {
     Socket socket{_node.lock(), port};
 
     if (port->direction == Port::Direction::IN) {
-        s = make_shared<GraphicsNodeSocket>(socket, this);
+        s = make_counted<GraphicsNodeSocket>(MemoryCategory::GRAPHICS, socket,
+                                             this);
         _sinks.push_back(s);
     } else {
-        s = make_shared<GraphicsNodeSocket>(socket, this);
+        s = make_counted<GraphicsNodeSocket>(MemoryCategory::GRAPHICS, socket,
+                                             this);
         _sources.push_back(s);
     }
 
+    // the geometry of the node is updated once all the sockets are added, in
+    // refreshNode()
     _changed = true;
-    prepareGeometryChange();
-    updateGeometry();
     return s;
 }
 
@@ -282,6 +286,28 @@ shared_ptr<GraphicsNodeSocket> GraphicsNode::getPort(Port *port) {
     }
 }
 
+void GraphicsNode::setNode(NodePtr node) {
+    // the sockets are bound to the previous node: start from scratch
+    for (auto s : _sinks) {
+        s->disconnect();
+        s->setParentItem(nullptr);
+    }
+    for (auto s : _sources) {
+        s->disconnect();
+        s->setParentItem(nullptr);
+    }
+    _sinks.clear();
+    _sources.clear();
+
+    _sub_structure_scene.reset();
+
+    _node = node;
+    _width = node->width();
+    _height = node->height();
+
+    refreshNode();
+}
+
 void GraphicsNode::disconnect() {
     for (auto s : _sinks) {
         s->disconnect();
@@ -307,9 +333,8 @@ void GraphicsNode::refreshNode() {
     color.setAlpha(120);
     setColors(color);
 
-    set<PortPtr> in_node = node->ports();
+    set<PortPtr> in_node(node->ports().begin(), node->ports().end());
     set<PortPtr> existing;
-    set<PortPtr> to_add;
     set<PortPtr> to_remove;
 
     for (auto s : _sinks) {
@@ -319,9 +344,6 @@ void GraphicsNode::refreshNode() {
         existing.insert(s->socket().port.lock());
     }
 
-    set_difference(in_node.begin(), in_node.end(), existing.begin(),
-                   existing.end(), inserter(to_add, to_add.begin()));
-
     set_difference(existing.begin(), existing.end(), in_node.begin(),
                    in_node.end(), inserter(to_remove, to_remove.begin()));
 
@@ -344,11 +366,13 @@ void GraphicsNode::refreshNode() {
         }
     }
 
-    for (auto port : to_add) {
-        add_socket(port);
+    // new sockets are added in the order of the ports of the node
+    for (auto port : node->ports()) {
+        if (!existing.count(port)) add_socket(port);
     }
 
     _changed = true;
+    prepareGeometryChange();
     updateGeometry();
 }
 
@@ -357,7 +381,14 @@ void GraphicsNode::updateNode(QString name) {
         throw logic_error("We should not be accessing a dead node!");
     }
 
-    _node.lock()->name(name.toStdString());
+    auto node = _node.lock();
+    if (node->name() == name.toStdString()) return;
+
+    auto nodescene = dynamic_cast<GraphicsNodeScene *>(scene());
+    auto topwindow =
+        dynamic_cast<MainWindow *>(nodescene->views()[0]->window());
+    topwindow->push_command(new RenameNodeCommand(
+        topwindow, nodescene->architecture, node, name.toStdString()));
 }
 
 void GraphicsNode::updateNodePos() {
@@ -366,20 +397,30 @@ void GraphicsNode::updateNodePos() {
     }
 
     auto node = _node.lock();
+    if (node->x() == x() && node->y() == y() && node->width() == width() &&
+        node->height() == height()) {
+        return;
+    }
+
     node->x(x());
     node->y(y());
     node->width(width());
     node->height(height());
+
+    auto nodescene = dynamic_cast<GraphicsNodeScene *>(scene());
+    if (nodescene) emit nodescene->nodeChanged(node);
 }
 
 void GraphicsNode::add_sink() {
-    _node.lock()->createPort(
-        {"input", Port::Direction::IN, Port::Type::EXPLICIT});
+    auto node = _node.lock();
+    node->createPort({node->unique_port_name("input"), Port::Direction::IN,
+                      Port::Type::EXPLICIT});
 }
 
 void GraphicsNode::add_source() {
-    _node.lock()->createPort(
-        {"output", Port::Direction::OUT, Port::Type::EXPLICIT});
+    auto node = _node.lock();
+    node->createPort({node->unique_port_name("output"), Port::Direction::OUT,
+                      Port::Type::EXPLICIT});
 }
 
 void GraphicsNode::updateGeometry() {
@@ -543,7 +584,10 @@ void GraphicsNode::disableGraphicsEffects() { _effect->setEnabled(false); }
 
 void GraphicsNode::enableGraphicsEffects() { _effect->setEnabled(true); }
 
-void GraphicsNode::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
+void GraphicsNode::releaseSubStructureScene() { _sub_structure_scene.reset(); }
+
+GraphicsNodeScene *GraphicsNode::subStructureScene() {
+    // the sub-architecture scene is only built when the user first enters it
     if (!_sub_structure_scene) {
         auto &sub_arch = _node.lock()->sub_architecture;
         if (!sub_arch) {
@@ -552,13 +596,19 @@ void GraphicsNode::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
             sub_arch.reset(new Architecture());
             sub_arch->name = _node.lock()->name();
             sub_arch->description = _node.lock()->name() + " is...";
+
+            auto nodescene = dynamic_cast<GraphicsNodeScene *>(scene());
+            emit nodescene->nodeChanged(_node.lock());
         }
         _sub_structure_scene.reset(
             new GraphicsNodeScene(sub_arch.get(), this, scene()->parent()));
     }
+    return _sub_structure_scene.get();
+}
 
+void GraphicsNode::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
     auto topwindow = dynamic_cast<MainWindow *>(scene()->views()[0]->window());
-    topwindow->set_active_scene(_sub_structure_scene.get());
+    topwindow->set_active_scene(subStructureScene());
 
     QGraphicsItem::mouseDoubleClickEvent(event);
 }
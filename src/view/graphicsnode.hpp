@@ -48,6 +48,12 @@ class GraphicsNode : public QGraphicsObject {
 
     const NodeWeakPtr node() { return _node; }
 
+    /**
+     * Binds this graphic node to another node. Used by the scene to recycle
+     * graphic nodes. The graphic node must not be part of a scene.
+     */
+    void setNode(NodePtr node);
+
     std::shared_ptr<GraphicsNodeSocket> getPort(Port *port);
 
     void disconnect();
@@ -84,6 +90,20 @@ class GraphicsNode : public QGraphicsObject {
     void add_sink();
     void add_source();
 
+    /**
+     * Deletes the scene displaying the sub-architecture of the node, if any.
+     * It is re-created from the sub-architecture the next time the user
+     * enters the node.
+     */
+    void releaseSubStructureScene();
+
+    /**
+     * Returns the scene displaying the sub-architecture of the node,
+     * creating it (and the sub-architecture itself, if the node has none
+     * yet) if needed.
+     */
+    GraphicsNodeScene *subStructureScene();
+
    protected:
     virtual void mousePressEvent(QGraphicsSceneMouseEvent *event) override {
         QGraphicsItem::mousePressEvent(event);
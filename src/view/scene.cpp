@@ -12,7 +12,10 @@
 #include <cmath>
 #include <iostream>
 
+#include "../app/commands.hpp"
 #include "../app/mainwindow.hpp"
+#include "../memory_stats.hpp"
+#include "../trace.hpp"
 #include "edge.hpp"
 #include "socket.hpp"
 
@@ -38,7 +41,8 @@ GraphicsNodeScene::GraphicsNodeScene(Architecture *architecture,
       _brush_background(_color_background),
       _arch_name(new EditableLabel()),
       _arch_version(new EditableLabel()),
-      _arch_desc(new EditableDescription()) {
+      _arch_desc(new EditableDescription()),
+      _virtualized(false) {
     // initialize default pen settings
     for (auto p : {&_pen_light, &_pen_dark, &_pen_null}) {
         p->setWidth(0);
@@ -86,23 +90,42 @@ GraphicsNodeScene::GraphicsNodeScene(Architecture *architecture,
 
     // if nodes/connections are already present in the architecture, create
     // corresponding GraphicsItems
-    for (auto n : architecture->nodes()) {
-        add(n);
-    }
-    for (auto c : architecture->connections()) {
-        add(c);
-    }
+    _virtualized = architecture->nodes().size() > VIRTUALIZATION_THRESHOLD;
+    populate(architecture->nodes(), architecture->connections());
 }
 
 shared_ptr<GraphicsNode> GraphicsNodeScene::add(NodePtr node) {
-    auto gNode = make_shared<GraphicsNode>(node);
+    auto existing = _node_items.find(node.get());
+    if (existing != _node_items.end()) {
+        return existing->second;
+    }
+
+    shared_ptr<GraphicsNode> gNode;
+
+    // recycle a previously released graphic node, if available
+    if (!_node_pool.empty()) {
+        gNode = _node_pool.back();
+        _node_pool.pop_back();
+        gNode->setNode(node);
+    } else {
+        gNode = make_counted<GraphicsNode>(MemoryCategory::GRAPHICS, node);
+    }
 
     // connecting the node controller with the node view, so that
     // updates to the node controller are reflected in the widget.
     connect(node.get(), &Node::dirty, gNode.get(), &GraphicsNode::refreshNode);
+    NodeWeakPtr weak_node = node;
+    connect(node.get(), &Node::dirty, gNode.get(), [this, weak_node]() {
+        emit nodeChanged(weak_node.lock());
+    });
 
     _nodes.insert(gNode);
+    _node_items[node.get()] = gNode;
     addItem(gNode.get());
+
+    if (_virtualized) {
+        index(node);
+    }
     return gNode;
 }
 
@@ -110,8 +133,20 @@ void GraphicsNodeScene::remove(std::shared_ptr<GraphicsNode> graphicNode) {
     auto node = graphicNode->node();
     if (node.expired()) {
         qWarning() << "Deleting a GraphicsNode for an already deleted node!";
+
+        // its key is gone with the node: look for the item itself
+        for (auto it = _node_items.begin(); it != _node_items.end(); ++it) {
+            if (it->second == graphicNode) {
+                _node_items.erase(it);
+                break;
+            }
+        }
     } else {
-        architecture->removeNode(node.lock());
+        auto n = node.lock();
+        emit nodeRemoved(n);
+        architecture->removeNode(n);
+        if (_virtualized) forget(n);
+        _node_items.erase(n.get());
     }
 
     graphicNode.get()->setSelected(false);
@@ -121,15 +156,33 @@ void GraphicsNodeScene::remove(std::shared_ptr<GraphicsNode> graphicNode) {
 }
 
 void GraphicsNodeScene::remove(NodePtr node) {
-    set<shared_ptr<GraphicsNode>> to_remove;
-    for (auto gn : _nodes) {
-        if (!gn->node().expired() && gn->node().lock() == node) {
-            to_remove.insert(gn);
-        }
+    auto gn = _node_items.find(node.get());
+    if (gn != _node_items.end()) {
+        remove(gn->second);
+    } else {
+        // not currently displayed
+        emit nodeRemoved(node);
+        architecture->removeNode(node);
+        if (_virtualized) forget(node);
+    }
+}
+
+void GraphicsNodeScene::remove(ConnectionPtr connection) {
+    auto item = _edge_items.find(connection.get());
+    if (item != _edge_items.end()) {
+        // the edge removes the connection from the architecture (cf
+        // onConnectionDisrupted)
+        auto edge = item->second;
+        edge->disconnect();
+        return;
     }
 
-    for (auto gn : to_remove) {
-        remove(gn);
+    // not currently displayed
+    emit connectionRemoved(connection);
+    architecture->removeConnection(connection->from, connection->to);
+    if (_virtualized) {
+        _node_connections[connection->from.node.lock().get()].erase(connection);
+        _node_connections[connection->to.node.lock().get()].erase(connection);
     }
 }
 
@@ -138,30 +191,95 @@ shared_ptr<GraphicsDirectedEdge> GraphicsNodeScene::add(
     auto from = connection->from.node.lock();
     auto to = connection->to.node.lock();
 
+    auto existing = _edge_items.find(connection.get());
+    if (existing != _edge_items.end()) {
+        return existing->second;
+    }
+
+    if (_virtualized) {
+        _node_connections[from.get()].insert(connection);
+        _node_connections[to.get()].insert(connection);
+
+        // the edge is only created if both its ends are displayed
+        if (!_node_items.count(from.get()) || !_node_items.count(to.get())) {
+            return nullptr;
+        }
+    }
+
     auto edge = make_edge();
+    edge->setUnderlyingConnection(connection);
 
     // look for the *graphic nodes* that represent the source/sink of
     // our connection:
-    auto source = find_if(_nodes.begin(), _nodes.end(),
-                          [&from](const shared_ptr<GraphicsNode> gNode) {
-                              return gNode->node().lock() == from;
-                          });
-
-    auto sink = find_if(_nodes.begin(), _nodes.end(),
-                        [&to](const shared_ptr<GraphicsNode> gNode) {
-                            return gNode->node().lock() == to;
-                        });
+    auto source = _node_items.at(from.get());
+    auto sink = _node_items.at(to.get());
 
     // qWarning() << "Connecting " << QString::fromStdString(from->name()) << "
     // to " << QString::fromStdString(to->name());
-    edge->connect((*source).get(), connection->from.port.lock().get(),
-                  (*sink).get(), connection->to.port.lock().get());
+    edge->connect(source.get(), connection->from.port.lock().get(), sink.get(),
+                  connection->to.port.lock().get());
 
     return edge;
 }
 
+void GraphicsNodeScene::populate(const Architecture::Nodes &nodes,
+                                 const Architecture::Connections &connections,
+                                 const Progress &progress) {
+    TraceScope trace("populate scene", "gui");
+
+    const size_t total = nodes.size() + connections.size();
+    size_t done = 0;
+
+    if (_virtualized) {
+        // only index the nodes and connections: the graphics items are
+        // created on demand, around the visible area
+        for (const auto& n : nodes) {
+            index(n);
+        }
+        for (const auto& c : connections) {
+            _node_connections[c->from.node.lock().get()].insert(c);
+            _node_connections[c->to.node.lock().get()].insert(c);
+        }
+        setVisibleArea(_visible_area);
+
+        if (progress) {
+            progress(total, total);
+        }
+        return;
+    }
+
+    // no need to repaint anything until all the items are in the scene
+    for (auto view : views()) {
+        view->setUpdatesEnabled(false);
+    }
+
+    for (const auto& n : nodes) {
+        add(n);
+        if (progress && ++done % POPULATE_BATCH_SIZE == 0) {
+            progress(done, total);
+        }
+    }
+
+    // edges are only created once all the nodes are laid out, so that each
+    // edge path is computed once, from the final positions of its sockets
+    for (const auto& c : connections) {
+        add(c);
+        if (progress && ++done % POPULATE_BATCH_SIZE == 0) {
+            progress(done, total);
+        }
+    }
+
+    for (auto view : views()) {
+        view->setUpdatesEnabled(true);
+    }
+
+    if (progress) {
+        progress(total, total);
+    }
+}
+
 shared_ptr<GraphicsDirectedEdge> GraphicsNodeScene::make_edge() {
-    auto edge = make_shared<GraphicsBezierEdge>();
+    auto edge = make_counted<GraphicsBezierEdge>(MemoryCategory::GRAPHICS);
 
     connect(edge.get(), &GraphicsDirectedEdge::connectionEstablished, this,
             &GraphicsNodeScene::onConnectionEstablished);
@@ -178,7 +296,19 @@ void GraphicsNodeScene::onConnectionEstablished(
     auto conn = architecture->createConnection(edge->source()->socket(),
                                                edge->sink()->socket());
 
+    // edges created for existing connections already have their underlying
+    // connection set
+    if (edge->connection().lock() != conn) {
+        emit connectionChanged(conn);
+    }
+
     edge->setUnderlyingConnection(conn);
+    _edge_items[conn.get()] = edge;
+
+    if (_virtualized) {
+        _node_connections[conn->from.node.lock().get()].insert(conn);
+        _node_connections[conn->to.node.lock().get()].insert(conn);
+    }
 }
 
 void GraphicsNodeScene::onConnectionDisrupted(
@@ -186,6 +316,241 @@ void GraphicsNodeScene::onConnectionDisrupted(
     // qWarning() << "Connection disrupted!";
     architecture->removeConnection(edge->source()->socket(),
                                    edge->sink()->socket());
+
+    auto conn = edge->connection().lock();
+    if (!conn) {
+        // the connection is already gone (eg, when removing a node), and
+        // its key with it: look for the edge itself
+        for (auto it = _edge_items.begin(); it != _edge_items.end(); ++it) {
+            if (it->second == edge) {
+                _edge_items.erase(it);
+                break;
+            }
+        }
+    } else {
+        auto item = _edge_items.find(conn.get());
+        if (item != _edge_items.end() && item->second == edge) {
+            _edge_items.erase(item);
+        }
+
+        emit connectionRemoved(conn);
+
+        if (_virtualized) {
+            _node_connections[conn->from.node.lock().get()].erase(conn);
+            _node_connections[conn->to.node.lock().get()].erase(conn);
+        }
+    }
+}
+
+void GraphicsNodeScene::setVirtualized(bool virtualized) {
+    if (virtualized == _virtualized) return;
+
+    TraceScope trace("setVirtualized", "gui");
+
+    if (virtualized) {
+        _virtualized = true;
+        for (const auto& n : architecture->nodes()) {
+            index(n);
+        }
+        for (const auto& c : architecture->connections()) {
+            _node_connections[c->from.node.lock().get()].insert(c);
+            _node_connections[c->to.node.lock().get()].insert(c);
+        }
+        setVisibleArea(_visible_area);
+    } else {
+        _virtualized = false;
+        _cells.clear();
+        _node_cells.clear();
+        _node_connections.clear();
+        _node_pool.clear();
+
+        // create all the missing items
+        Architecture::Nodes missing_nodes;
+        for (const auto& n : architecture->nodes()) {
+            if (!_node_items.count(n.get())) missing_nodes.insert(n);
+        }
+        Architecture::Connections missing_connections;
+        for (const auto& c : architecture->connections()) {
+            if (!_edge_items.count(c.get())) missing_connections.insert(c);
+        }
+        populate(missing_nodes, missing_connections);
+    }
+    update();
+}
+
+void GraphicsNodeScene::setVisibleArea(const QRectF &area) {
+    _visible_area = area;
+
+    if (!_virtualized) return;
+
+    TraceScope trace("setVisibleArea", "gui");
+
+    // items are created in an area slightly larger than the visible one, and
+    // only released once far enough from it, so that they are not recreated
+    // over and over again while panning
+    auto dx = area.width() / 2;
+    auto dy = area.height() / 2;
+    auto live_area = area.adjusted(-dx, -dy, dx, dy);
+    auto kept_area = area.adjusted(-2 * dx, -2 * dy, 2 * dx, 2 * dy);
+
+    vector<shared_ptr<GraphicsNode>> to_release;
+    for (auto gNode : _nodes) {
+        if (!gNode->isSelected() &&
+            !kept_area.intersects(gNode->sceneBoundingRect())) {
+            to_release.push_back(gNode);
+        }
+    }
+    for (auto gNode : to_release) {
+        release(gNode);
+    }
+
+    // the budget of live nodes is spent on the visible area first, and only
+    // then on the margin around it
+    vector<NodePtr> added;
+    for (const auto &candidates : {nodesIn(area), nodesIn(live_area)}) {
+        for (auto node : candidates) {
+            if (_nodes.size() >= VIRTUALIZATION_MAX_LIVE_NODES) break;
+
+            if (!_node_items.count(node.get())) {
+                add(node);
+                added.push_back(node);
+            }
+        }
+    }
+
+    // once the nodes are there, create the edges between them. add() only
+    // re-inserts connections that are already listed, which leaves both the
+    // map and the set we iterate over untouched
+    for (auto node : added) {
+        auto connections = _node_connections.find(node.get());
+        if (connections == _node_connections.end()) continue;
+
+        for (const auto &c : connections->second) {
+            add(c);
+        }
+    }
+
+    // repaint the proxies
+    update();
+}
+
+GraphicsNodeScene::Cell GraphicsNodeScene::cell(double x, double y) const {
+    return {static_cast<int>(std::floor(x / VIRTUALIZATION_CELL_SIZE)),
+            static_cast<int>(std::floor(y / VIRTUALIZATION_CELL_SIZE))};
+}
+
+QRectF GraphicsNodeScene::proxyRect(ConstNodePtr node) const {
+    // same minimal size as the graphic nodes
+    return QRectF(node->x(), node->y(), std::max(node->width(), 160.),
+                  std::max(node->height(), 120.));
+}
+
+void GraphicsNodeScene::refreshGeometry() {
+    for (auto gNode : _nodes) {
+        // each call writes the whole geometry of the item back to the node
+        auto node = gNode->node().lock();
+        QRectF geometry(node->x(), node->y(), node->width(), node->height());
+        gNode->setSize(geometry.size());
+        gNode->setPos(geometry.topLeft());
+    }
+
+    if (!_virtualized) return;
+
+    for (auto n : architecture->nodes()) {
+        index(n);
+    }
+    setVisibleArea(_visible_area);
+}
+
+void GraphicsNodeScene::index(NodePtr node) {
+    unindex(node.get());
+
+    auto c = cell(node->x(), node->y());
+    _cells[c].insert(node);
+    _node_cells[node.get()] = c;
+}
+
+void GraphicsNodeScene::unindex(const Node *node) {
+    auto c = _node_cells.find(node);
+    if (c == _node_cells.end()) return;
+
+    auto &nodes = _cells[c->second];
+    for (auto n = nodes.begin(); n != nodes.end(); ++n) {
+        if (n->get() == node) {
+            nodes.erase(n);
+            break;
+        }
+    }
+    if (nodes.empty()) _cells.erase(c->second);
+
+    _node_cells.erase(c);
+}
+
+vector<NodePtr> GraphicsNodeScene::nodesIn(const QRectF &area) const {
+    vector<NodePtr> result;
+
+    // nodes are indexed by their top-left corner: also look one cell up and
+    // left of the area, for the nodes that overlap it
+    auto top_left = cell(area.left(), area.top());
+    auto bottom_right = cell(area.right(), area.bottom());
+
+    for (int x = top_left.first - 1; x <= bottom_right.first; x++) {
+        for (int y = top_left.second - 1; y <= bottom_right.second; y++) {
+            auto c = _cells.find({x, y});
+            if (c == _cells.end()) continue;
+
+            for (auto node : c->second) {
+                if (area.intersects(proxyRect(node))) {
+                    result.push_back(node);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void GraphicsNodeScene::forget(NodePtr node) {
+    // the connections of the node are gone as well. Copy them first, as
+    // _node_connections[node] is modified while iterating.
+    auto connections = _node_connections[node.get()];
+    for (auto c : connections) {
+        _node_connections[c->from.node.lock().get()].erase(c);
+        _node_connections[c->to.node.lock().get()].erase(c);
+    }
+    _node_connections.erase(node.get());
+    unindex(node.get());
+}
+
+void GraphicsNodeScene::release(shared_ptr<GraphicsNode> gNode) {
+    auto node = gNode->node().lock();
+
+    // the edges are released silently: the underlying connections are still
+    // there
+    for (auto c : _node_connections[node.get()]) {
+        auto edge = _edge_items.find(c.get());
+        if (edge != _edge_items.end()) {
+            release(edge->second);
+        }
+    }
+
+    QObject::disconnect(node.get(), &Node::dirty, gNode.get(), nullptr);
+    removeItem(gNode.get());
+    _node_items.erase(node.get());
+    _nodes.erase(gNode);
+
+    // the node might have been moved while displayed
+    index(node);
+
+    _node_pool.push_back(gNode);
+}
+
+void GraphicsNodeScene::release(shared_ptr<GraphicsDirectedEdge> edge) {
+    _edge_items.erase(edge->connection().lock().get());
+    _edges.erase(edge);
+
+    // the connection must not be removed from the architecture
+    edge->blockSignals(true);
+    edge->disconnect();
 }
 
 void GraphicsNodeScene::onDescriptionChanged(const QString &content) {
@@ -238,6 +603,11 @@ set<shared_ptr<GraphicsNode>> GraphicsNodeScene::selected() const {
     return selectedNodes;
 }
 
+shared_ptr<GraphicsNode> GraphicsNodeScene::item(const Node* node) const {
+    auto it = _node_items.find(node);
+    return it == _node_items.end() ? nullptr : it->second;
+}
+
 set<shared_ptr<GraphicsDirectedEdge>> GraphicsNodeScene::selectedEdges() const {
     set<shared_ptr<GraphicsDirectedEdge>> selectedEdges;
 
@@ -266,6 +636,46 @@ void GraphicsNodeScene::set_description(const string &name,
 void GraphicsNodeScene::drawBackground(QPainter *painter, const QRectF &rect) {
     if (!_paintBackground) return;
 
+    drawGrid(painter, rect);
+
+    if (_virtualized) {
+        drawProxies(painter, rect);
+    }
+}
+
+void GraphicsNodeScene::drawProxies(QPainter *painter, const QRectF &rect) {
+    // connections with at least one end not displayed are drawn as straight
+    // lines. Connections with both ends outside of the painted area are not
+    // drawn at all.
+    painter->setPen(QPen(DEFAULT_EDGE_COLOR, 2));
+    for (auto node : nodesIn(rect)) {
+        auto connections = _node_connections.find(node.get());
+        if (connections == _node_connections.end()) continue;
+
+        for (auto c : connections->second) {
+            if (_edge_items.count(c.get())) continue;
+
+            auto from = c->from.node.lock();
+            auto to = c->to.node.lock();
+            if (!from || !to) continue;
+
+            painter->drawLine(proxyRect(from).center(), proxyRect(to).center());
+        }
+    }
+
+    painter->setPen(Qt::NoPen);
+    for (auto node : nodesIn(rect)) {
+        if (_node_items.count(node.get())) continue;
+
+        auto color =
+            QColor(QString::fromStdString(LABEL_COLORS.at(node->label())));
+        color.setAlpha(120);
+        painter->setBrush(color);
+        painter->drawRoundedRect(proxyRect(node), 10, 10);
+    }
+}
+
+void GraphicsNodeScene::drawGrid(QPainter *painter, const QRectF &rect) {
     // call parent method
     QGraphicsScene::drawBackground(painter, rect);
 
@@ -330,12 +740,23 @@ void GraphicsNodeScene::keyPressEvent(QKeyEvent *event) {
         ////// DELETE
         case Qt::Key_X:
         case Qt::Key_Delete: {
+            Architecture::Nodes nodes;
             for (auto graphicNode : selected()) {
-                remove(graphicNode);
+                if (!graphicNode->node().expired()) {
+                    nodes.insert(graphicNode->node().lock());
+                }
             }
+            Architecture::Connections connections;
             for (auto e : selectedEdges()) {
-                e->disconnect();
+                auto connection = e->connection().lock();
+                if (connection) connections.insert(connection);
             }
+            if (nodes.empty() && connections.empty()) break;
+
+            // a single (undoable) command, whatever the number of nodes
+            auto topwindow = dynamic_cast<MainWindow *>(views()[0]->window());
+            topwindow->push_command(
+                new RemoveCommand(topwindow, architecture, nodes, connections));
             break;
         }
 
@@ -343,18 +764,30 @@ void GraphicsNodeScene::keyPressEvent(QKeyEvent *event) {
         case Qt::Key_D:
             if (!(event->modifiers() == Qt::ControlModifier))
                 break;  // check for Ctrl+D
-        case Qt::Key_Space:
+        case Qt::Key_Space: {
+            Architecture::Nodes copies;
             for (auto graphicNode : selected()) {
                 if (!graphicNode->node().expired()) {
                     graphicNode->setSelected(false);
-                    auto copy = graphicNode->node().lock()->duplicate();
-                    architecture->addNode(copy);
-                    auto duplicatedGraphicNode = this->add(copy);
-                    duplicatedGraphicNode->setPos(graphicNode->pos());
-                    duplicatedGraphicNode->setSelected(true);
+                    auto node = graphicNode->node().lock();
+                    auto copy = node->duplicate();
+                    copy->x(node->x());
+                    copy->y(node->y());
+                    copies.insert(copy);
                 }
             }
+            if (copies.empty()) break;
+
+            auto topwindow = dynamic_cast<MainWindow *>(views()[0]->window());
+            topwindow->push_command(new AddNodesCommand(
+                topwindow, architecture, copies, "Duplicate nodes"));
+
+            for (auto copy : copies) {
+                auto item = _node_items.find(copy.get());
+                if (item != _node_items.end()) item->second->setSelected(true);
+            }
             break;
+        }
 
         ///// (DE-)SELECT ALL
         case Qt::Key_A: {
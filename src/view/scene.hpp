@@ -5,8 +5,11 @@
 
 #include <QGraphicsScene>
 #include <QRectF>
+#include <functional>
+#include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 #include "../architecture.hpp"
 #include "../connection.hpp"
@@ -16,6 +19,22 @@
 
 const int GRIDSIZE = 20;
 
+// number of graphics items created between two progress notifications when
+// populating a scene
+const size_t POPULATE_BATCH_SIZE = 200;
+
+// architectures with more nodes than this are displayed in virtualized mode
+// by default
+const size_t VIRTUALIZATION_THRESHOLD = 2000;
+
+// in virtualized mode, maximum number of live graphic nodes. Beyond that
+// (typically when zooming out), nodes are only painted as proxies.
+const size_t VIRTUALIZATION_MAX_LIVE_NODES = 1000;
+
+// size of the cells of the grid used to spatially index the nodes in
+// virtualized mode
+const int VIRTUALIZATION_CELL_SIZE = 1000;
+
 class GraphicsNodeScene : public QGraphicsScene {
     Q_OBJECT
 
@@ -23,13 +42,55 @@ class GraphicsNodeScene : public QGraphicsScene {
     GraphicsNodeScene(Architecture* architecture,
                       GraphicsNode* parent_node = nullptr, QObject* parent = 0);
 
+    typedef std::function<void(size_t done, size_t total)> Progress;
+
     std::shared_ptr<GraphicsNode> add(NodePtr node);
     void remove(std::shared_ptr<GraphicsNode> node);
     void remove(NodePtr node);
     std::shared_ptr<GraphicsDirectedEdge> add(ConnectionPtr connection);
+    void remove(ConnectionPtr connection);
     std::shared_ptr<GraphicsDirectedEdge> make_edge();
 
+    /**
+     * Bulk-creates the graphics items for a (possibly large) set of nodes
+     * and connections. Repaints of the views are suppressed until all the
+     * items are created, and 'progress' (if set) is called after each batch
+     * of POPULATE_BATCH_SIZE items.
+     */
+    void populate(const Architecture::Nodes& nodes,
+                  const Architecture::Connections& connections,
+                  const Progress& progress = nullptr);
+
+    /**
+     * In virtualized mode, graphics items are only created for the nodes
+     * (and connections) around the area displayed by the view. The other
+     * nodes are painted as lightweight proxies in the background, and the
+     * graphics items are recycled as the user pans. Meant for very large
+     * architectures.
+     */
+    void setVirtualized(bool virtualized);
+    bool virtualized() const { return _virtualized; }
+
+    /**
+     * Informs the scene of the area currently displayed by the view. In
+     * virtualized mode, creates the missing graphics items around that area,
+     * and releases the ones far from it.
+     */
+    void setVisibleArea(const QRectF& area);
+
+    /**
+     * Moves and resizes the graphics items after their nodes, once moved as a
+     * whole in the model (eg auto-layout).
+     */
+    void refreshGeometry();
+
     std::set<std::shared_ptr<GraphicsNode>> selected() const;
+
+    /**
+     * Returns the graphics item of the node, or nullptr if there is none (in
+     * virtualized mode, the node is not around the visible area).
+     */
+    std::shared_ptr<GraphicsNode> item(const Node* node) const;
     std::set<std::shared_ptr<GraphicsDirectedEdge>> selectedEdges() const;
 
     Architecture* architecture;
@@ -50,11 +111,39 @@ class GraphicsNodeScene : public QGraphicsScene {
     void disableGraphicsEffects();
     void enableGraphicsEffects();
 
+   signals:
+    // changes made to the architecture through the scene, so that they can
+    // be journaled
+    void nodeChanged(ConstNodePtr node);
+    void nodeRemoved(ConstNodePtr node);
+    void portRenamed(ConstNodePtr node, const std::string& from,
+                     const std::string& to);
+    void connectionChanged(ConstConnectionPtr connection);
+    void connectionRemoved(ConstConnectionPtr connection);
+
    protected:
     virtual void drawBackground(QPainter* painter, const QRectF& rect) override;
     virtual void keyPressEvent(QKeyEvent* event) override;
 
    private:
+    typedef std::pair<int, int> Cell;
+
+    Cell cell(double x, double y) const;
+    QRectF proxyRect(ConstNodePtr node) const;
+
+    // spatial index of the nodes, in virtualized mode
+    void index(NodePtr node);
+    void unindex(const Node* node);
+    std::vector<NodePtr> nodesIn(const QRectF& area) const;
+    // drops a removed node from the index, with its connections
+    void forget(NodePtr node);
+
+    void release(std::shared_ptr<GraphicsNode> node);
+    void release(std::shared_ptr<GraphicsDirectedEdge> edge);
+
+    void drawGrid(QPainter* painter, const QRectF& rect);
+    void drawProxies(QPainter* painter, const QRectF& rect);
+
     QColor _color_background;
     QColor _color_light;
     QColor _color_dark;
@@ -75,6 +164,20 @@ class GraphicsNodeScene : public QGraphicsScene {
 
     std::set<std::shared_ptr<GraphicsNode>> _nodes;
     std::set<std::shared_ptr<GraphicsDirectedEdge>> _edges;
+
+    // graphic nodes, indexed by the node they represent
+    std::map<const Node*, std::shared_ptr<GraphicsNode>> _node_items;
+    // edges, indexed by their underlying connection
+    std::map<const Connection*, std::shared_ptr<GraphicsDirectedEdge>>
+        _edge_items;
+
+    bool _virtualized;
+    QRectF _visible_area;
+    std::map<Cell, std::set<NodePtr>> _cells;
+    std::map<const Node*, Cell> _node_cells;
+    std::map<const Node*, std::set<ConnectionPtr>> _node_connections;
+    // released graphic nodes, ready to be bound to another node
+    std::vector<std::shared_ptr<GraphicsNode>> _node_pool;
 };
 
 #endif /* __GRAPHICSNODESCENE_HPP__7F9E4C1E_8F4E_4BD2_BDF7_3D4ECEC206B5 */
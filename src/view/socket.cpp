@@ -17,6 +17,7 @@
 #include <iostream>
 
 #include "edge.hpp"
+#include "scene.hpp"
 #include "tinybutton.hpp"
 
 using namespace std;
@@ -116,6 +117,22 @@ void GraphicsNodeSocket::onDeletion() {
     }
 }
 
+void GraphicsNodeSocket::setPortName(const QString &name) {
+    auto node = _socket.node.lock();
+    auto port = _socket.port.lock();
+    auto previous = port->name;
+    if (!node->rename_port(port, name.toStdString())) {
+        // another port of the node already has this name
+        _text->setPlainText(QString::fromStdString(previous));
+        return;
+    }
+
+    auto nodescene = dynamic_cast<GraphicsNodeScene *>(scene());
+    if (nodescene) {
+        emit nodescene->portRenamed(node, previous, port->name);
+    }
+}
+
 void GraphicsNodeSocket::placeLabel() {
     auto bb = _text->boundingRect();
 
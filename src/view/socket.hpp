@@ -114,9 +114,7 @@ class GraphicsNodeSocket : public QObject, public QGraphicsItem {
     void onDeletion();
     void placeLabel();
 
-    void setPortName(const QString &name) {
-        _socket.port.lock()->name = name.toStdString();
-    }
+    void setPortName(const QString &name);
 
    private:
     Socket _socket;
@@ -44,6 +44,19 @@ void GraphicsNodeView::resizeEvent(QResizeEvent *event) {
         first_resize = false;
     }
     QGraphicsView::resizeEvent(event);
+    updateVisibleArea();
+}
+
+void GraphicsNodeView::scrollContentsBy(int dx, int dy) {
+    QGraphicsView::scrollContentsBy(dx, dy);
+    updateVisibleArea();
+}
+
+void GraphicsNodeView::updateVisibleArea() {
+    auto nodescene = dynamic_cast<GraphicsNodeScene *>(scene());
+    if (!nodescene) return;
+
+    nodescene->setVisibleArea(mapToScene(viewport()->rect()).boundingRect());
 }
 
 void GraphicsNodeView::wheelEvent(QWheelEvent *event) {
@@ -57,6 +70,7 @@ void GraphicsNodeView::wheelEvent(QWheelEvent *event) {
             // zoom out
             scale(1.0 / scaleFactor, 1.0 / scaleFactor);
         }
+        updateVisibleArea();
         event->accept();
     } else {
         QGraphicsView::wheelEvent(event);
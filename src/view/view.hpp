@@ -45,12 +45,19 @@ class GraphicsNodeView : public QGraphicsView {
     void disableGraphicsEffects();
     void enableGraphicsEffects();
 
+    /**
+     * Tells the scene which area is currently displayed. Needed by the scene
+     * in virtualized mode.
+     */
+    void updateVisibleArea();
+
    protected:
     virtual void wheelEvent(QWheelEvent *event);
     virtual void mouseMoveEvent(QMouseEvent *event);
     virtual void mousePressEvent(QMouseEvent *event);
     virtual void mouseReleaseEvent(QMouseEvent *event);
     virtual void resizeEvent(QResizeEvent *event);
+    virtual void scrollContentsBy(int dx, int dy);
 
 
    private:
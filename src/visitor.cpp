@@ -1,12 +1,50 @@
 #include "visitor.hpp"
 #include "node.hpp"
+#include "trace.hpp"
 
-#include <boost/algorithm/string.hpp> // for search and replace
+#include <array>
 #include <boost/uuid/uuid_io.hpp>
-#include <regex>
+#include <iostream>
+#include <mutex>
 
 using namespace std;
 
+namespace {
+
+const string TEXTBACKSLASH("textbackslash");
+
+// replacement of each character in tex_escape (nullptr: kept as is).
+//
+// The generated documents rely on a few quirks of the escaping: the braces
+// of '^' are escaped, but not those of '~', and '{}' is appended to any
+// literal 'textbackslash' (see tex_escape).
+const array<const char *, 256> &tex_escapes() {
+  static const auto escapes = []() {
+    array<const char *, 256> escapes{};
+    escapes['\\'] = "\\textbackslash{}";
+    escapes['{'] = "\\{";
+    escapes['}'] = "\\}";
+    escapes['$'] = "\\$";
+    escapes['&'] = "\\&";
+    escapes['#'] = "\\#";
+    escapes['^'] = "\\textasciicircum\\{\\}";
+    escapes['_'] = "\\_";
+    escapes['~'] = "\\textasciitilde{}";
+    escapes['%'] = "\\%";
+    return escapes;
+  }();
+  return escapes;
+}
+
+mutex log_mutex;
+
+} // namespace
+
+ExportLog::~ExportLog() {
+  lock_guard<mutex> lock(log_mutex);
+  cerr << _line.str() << endl;
+}
+
 void capitalize(std::string &input) {
   std::string::iterator pos = input.begin();
   *pos = (char)toupper(*input.begin());
@@ -32,21 +70,53 @@ Visitor::Visitor(const Architecture &architecture)
     : architecture(architecture) {}
 
 string Visitor::visit() {
-  startUp();
+  TraceScope trace("Visitor::visit", "export");
+  if (trace.enabled()) {
+    trace.arg("architecture", architecture.name);
+  }
+
+  {
+    TraceScope hook("startUp", "export");
+    startUp();
+  }
 
-  beginNodes();
+  {
+    TraceScope hook("beginNodes", "export");
+    beginNodes();
+  }
   for (const auto &node : architecture.nodes()) {
+    TraceScope hook("onNode", "export");
+    if (hook.enabled()) {
+      hook.arg("node", node->name());
+    }
     onNode(node);
   }
-  endNodes();
+  {
+    TraceScope hook("endNodes", "export");
+    endNodes();
+  }
 
-  beginConnections();
+  {
+    TraceScope hook("beginConnections", "export");
+    beginConnections();
+  }
   for (const auto &connection : architecture.connections()) {
+    TraceScope hook("onConnection", "export");
+    if (hook.enabled()) {
+      hook.arg("connection", connection->name.str());
+    }
     onConnection(connection);
   }
-  endConnections();
+  {
+    TraceScope hook("endConnections", "export");
+    endConnections();
+  }
 
-  tearDown();
+  {
+    TraceScope hook("tearDown", "export");
+    tearDown();
+  }
+  _context.set(context_size());
 
   return _content;
 }
@@ -67,7 +137,7 @@ tuple<string, string> Visitor::get_id(const boost::uuids::uuid &id,
           throw runtime_error("No node or connection with id " + ss.str() +
                               "!");
         }
-        _id_mappings[id] = make_id(connection->name);
+        _id_mappings[id] = make_id(connection->name.str());
       } else {
         _id_mappings[id] = make_id(node->name());
       }
@@ -133,25 +203,29 @@ string Visitor::make_id(const std::string &name, bool ignore_duplicates) {
       result += '-';
       break;
     default:
-      result += tolower(c);
+      if (!isspace(static_cast<unsigned char>(c))) {
+        result += tolower(c);
+      }
     }
   }
 
-  string id = regex_replace(result, regex("\\s"), "");
+  string id(std::move(result));
 
   if (id.empty()) {
     id = "anonymous";
   }
 
   if (!ignore_duplicates) {
-    // check if the id is already in use. If so, append a number to it
+    // check if the id is already in use. If so, append a number to it.
+    // The ids are never released: the suffixes below the last one used
+    // for this base are all taken, and need not be probed again.
     if (_used_ids.find(id) != _used_ids.end()) {
-      int i = 1;
+      auto &suffix = _next_suffixes.emplace(id, 1).first->second;
       string new_id;
       do {
-        new_id = id + to_string(i++);
+        new_id = id + to_string(suffix++);
       } while (_used_ids.find(new_id) != _used_ids.end());
-      id = new_id;
+      id = std::move(new_id);
     }
   }
   _used_ids.insert(id);
@@ -159,28 +233,66 @@ string Visitor::make_id(const std::string &name, bool ignore_duplicates) {
   return id;
 }
 
-std::string Visitor::tex_escape(const std::string &text) {
-  string result(text);
-  trim(result);
+vector<string> Visitor::get_ids(const vector<ConstNodePtr> &nodes) {
+  vector<string> ids;
+  ids.reserve(nodes.size());
+  for (const auto &node : nodes) {
+    ids.push_back(get<0>(get_id(node->uuid)));
+  }
+  return ids;
+}
 
-  // special-case the backslash
-  boost::replace_all(result, "\\", "\\textbackslash");
+ConstNodePtr Visitor::get_node_by_id(const std::string &id) const {
+  for (const auto &kv : _id_mappings) {
+    if (kv.second == id) {
+      return architecture.node(kv.first);
+    }
+  }
+  return nullptr;
+}
 
-  map<string, string> tex_substitutions{
-      {"{", "\\{"}, {"}", "\\}"},
-      {"$", "\\$"}, {"&", "\\&"},
-      {"#", "\\#"}, {"^", "\\textasciicircum{}"},
-      {"_", "\\_"}, {"~", "\\textasciitilde{}"},
-      {"%", "\\%"}};
+std::string Visitor::tex_escape(const std::string &text) {
+  string result;
+  tex_escape(text, result);
+  return result;
+}
 
-  for (const auto &kv : tex_substitutions) {
-    boost::replace_all(result, kv.first, kv.second);
+void Visitor::tex_escape(const std::string &text, std::string &output) {
+  const auto &escapes = tex_escapes();
+
+  auto is_space = [](char c) { return std::isspace((unsigned char)c); };
+  auto begin = find_if_not(text.begin(), text.end(), is_space);
+  auto end =
+      find_if_not(text.rbegin(), make_reverse_iterator(begin), is_space)
+          .base();
+
+  output.reserve(output.size() + (end - begin) + (end - begin) / 4);
+
+  for (auto it = begin; it != end; ++it) {
+    const auto *escape = escapes[(unsigned char)*it];
+    if (escape) {
+      output += escape;
+    } else if (*it == 't' && end - it >= (ptrdiff_t)TEXTBACKSLASH.size() &&
+               equal(TEXTBACKSLASH.begin(), TEXTBACKSLASH.end(), it)) {
+      // a literal 'textbackslash' got '{}' appended as well
+      output += TEXTBACKSLASH;
+      output += "{}";
+      it += TEXTBACKSLASH.size() - 1;
+    } else {
+      output += *it;
+    }
   }
+}
 
-  // finish the backslash special-case
-  boost::replace_all(result, "textbackslash", "textbackslash{}");
-
-  return result;
+std::string Visitor::make_anchor(const std::string &text) {
+  string anchor(text);
+  for (auto &c : anchor) {
+    if (!(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') &&
+        !(c >= '0' && c <= '9')) {
+      c = '-';
+    }
+  }
+  return anchor;
 }
 
 EdgeType Visitor::get_edge_type(const std::string &name) const {
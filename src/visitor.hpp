@@ -2,9 +2,14 @@
 #define VISITOR_HPP
 
 #include <memory>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "architecture.hpp"
+#include "memory_stats.hpp"
 #include "node.hpp"
 
 #include <algorithm>
@@ -53,6 +58,30 @@ static const std::map<NodeType, std::string> NODE_TYPE_NAMES{
     {NodeType::SKILL, "skill"}, {NodeType::UNKNOWN, "unknown"},
 };
 
+/**
+ * A line of progress logged by the exporters, on stderr (stdout is for the
+ * exported content):
+ *
+ *   export_log() << "Generating " << file << "...";
+ *
+ * The line is written at once at the end of the statement, so that the
+ * lines of concurrent exports (see Daemon) do not interleave.
+ */
+class ExportLog {
+public:
+  ~ExportLog();
+
+  template <class T> ExportLog &operator<<(const T &value) {
+    _line << value;
+    return *this;
+  }
+
+private:
+  std::ostringstream _line;
+};
+
+inline ExportLog export_log() { return ExportLog(); }
+
 class Visitor {
 public:
   Visitor(const Architecture &architecture);
@@ -69,11 +98,42 @@ protected:
   virtual void endConnections(){};
   virtual void tearDown(){};
 
+  /**
+   * Approximate memory held by the context built during the visit (eg, the
+   * JSON document passed to the templates). It is accounted as
+   * MemoryCategory::EXPORT from the end of the visit until the visitor is
+   * destroyed.
+   */
+  virtual size_t context_size() const { return 0; }
+
   std::string make_id(const std::string &name, bool ignore_duplicates = false);
   std::tuple<std::string, std::string>
   get_id(const boost::uuids::uuid &id, const std::string &using_name = "");
 
+  /**
+   * Returns the ids of the given nodes (as returned by get_id), eg to list
+   * the nodes in the order computed by a Graph.
+   */
+  std::vector<std::string> get_ids(const std::vector<ConstNodePtr> &nodes);
+
+  /**
+   * Returns the node with the given id (as returned by get_id), or nullptr.
+   */
+  ConstNodePtr get_node_by_id(const std::string &id) const;
+
+  /**
+   * Escapes the TeX special characters of 'name' (trimmed), in a single
+   * pass. The second form appends the result to 'output', eg to reuse its
+   * buffer.
+   */
   std::string tex_escape(const std::string &name);
+  void tex_escape(const std::string &name, std::string &output);
+
+  /**
+   * Returns 'name' with all the non-alphanumeric (ASCII) characters
+   * replaced by '-'.
+   */
+  std::string make_anchor(const std::string &name);
 
   /**
    * Returns the edge type of a given string, based on its prefix:
@@ -99,8 +159,13 @@ protected:
 
   const Architecture &architecture;
 
-  std::set<std::string> _used_ids;
+  std::unordered_set<std::string> _used_ids;
+  // next suffix to try for each base id (see make_id)
+  std::unordered_map<std::string, int> _next_suffixes;
   std::map<boost::uuids::uuid, std::string> _id_mappings;
+
+private:
+  MemoryStats::Account _context{MemoryCategory::EXPORT};
 };
 
 #endif // VISITOR_HPP